@@ -2,7 +2,11 @@
 
 SET CommonCompilerFlags=-Od -MTd -nologo -fp:fast -fp:except- -Gm- -GR- -EHa- -d2Zi+ -Oi -WX -W4 -wd4201 -wd4100 -wd4189 -wd4505 -wd4127 -FC -Z7
 SET CommonCompilerFlags=-DNAMELESS_WATCHER_INTERNAL=1 -DNAMELESS_WATCHER_SLOW=1 -DNAMELESS_WATCHER_WIN32=1 %CommonCompilerFlags%
-SET CommonLinkerFlags= -incremental:no -opt:ref user32.lib gdi32.lib winmm.lib opengl32.lib
+
+REM The game runs every frame, and -overlay-bench times its overlay, so it's always built optimized
+SET OptimizedCompilerFlags=-O2 -MT -nologo -fp:fast -fp:except- -Gm- -GR- -EHa- -Oi -WX -W4 -wd4201 -wd4100 -wd4189 -wd4505 -wd4127 -FC -Z7
+SET OptimizedCompilerFlags=-DNAMELESS_WATCHER_INTERNAL=1 -DNAMELESS_WATCHER_SLOW=1 -DNAMELESS_WATCHER_WIN32=1 %OptimizedCompilerFlags%
+SET CommonLinkerFlags= -incremental:no -opt:ref user32.lib gdi32.lib winmm.lib opengl32.lib psapi.lib
 
 REM TODO - can we just build both with one exe?
 
@@ -17,7 +21,7 @@ REM cl %CommonCompilerFlags% ..\src\win32_watcher.cpp /link -subsystem:windows,5
 REM 64-bit build
 REM Optimization switches /wO2
 ECHO WAITING FOR PDB > lock.tmp
-cl %CommonCompilerFlags% -Fewatcher.dll ..\src\main.cpp -Fmwatcher.map -LD /link -incremental:no -opt:ref -PDB:watcher_%random%.pdb -EXPORT:GameGetSoundSamples -EXPORT:GameUpdateAndRender
+cl %OptimizedCompilerFlags% -Fewatcher.dll ..\src\main.cpp -Fmwatcher.map -LD /link -incremental:no -opt:ref -PDB:watcher_%random%.pdb -EXPORT:GameGetSoundSamples -EXPORT:GameUpdateAndRender -EXPORT:GameDrawPerformanceOverlay
 SET LastError=%ERRORLEVEL%
 DEL lock.tmp
 cl %CommonCompilerFlags% -Fewin32_watcher.exe ..\src\win32_watcher.cpp -Fmwin32_watcher.map /link %CommonLinkerFlags%
@@ -1,24 +1,83 @@
 #include "watcher_platform.h"
+#include "watcher_memory.h"
+#include "watcher_overlay.h"
 
-// TODO: Correct keywords
-static int g_x_offset;
-static int g_y_offset;
+struct GameState {
+    bool32 is_initialized;
 
-internal void RenderWeirdGradient(GameOffscreenBuffer* buffer, int x_offset, int y_offset) {
-    uint8_t* row = static_cast<uint8_t*>(buffer->memory);
+    // Note: Everything in permanent storage after the GameState itself
+    MemoryArena world_arena;
 
-    for(int y = 0; y < buffer->height; ++y) {
+    int x_offset;
+    int y_offset;
+};
+
+struct TransientState {
+    bool32 is_initialized;
+
+    // Note: Everything in transient storage after the TransientState itself
+    MemoryArena transient_arena;
+
+    OverlayState* overlay;
+};
+
+struct RenderWeirdGradientWork {
+    GameOffscreenBuffer* buffer;
+    int x_offset;
+    int y_offset;
+};
+
+internal void RenderWeirdGradientRows(void* data, int32_t first_row, int32_t one_past_last_row) {
+    RenderWeirdGradientWork* work = static_cast<RenderWeirdGradientWork*>(data);
+    GameOffscreenBuffer* buffer = work->buffer;
+    uint8_t* row = static_cast<uint8_t*>(buffer->memory) + first_row * buffer->pitch;
+
+    for(int y = first_row; y < one_past_last_row; ++y) {
         uint32_t* pixel = reinterpret_cast<uint32_t*>(row);
 
         for(int x = 0; x < buffer->width; ++x) {
-            *pixel++ = ((x + x_offset) << 8) | (y + y_offset);
+            *pixel++ = ((x + work->x_offset) << 8) | (y + work->y_offset);
         }
 
         row += buffer->pitch;
     }
 }
 
-void GameUpdateAndRender(GameInput* input, GameOffscreenBuffer* buffer) {
+internal void RenderWeirdGradient(PlatformApi* platform, GameOffscreenBuffer* buffer, int x_offset, int y_offset) {
+    RenderWeirdGradientWork work = { buffer, x_offset, y_offset };
+    platform->parallel_for(platform->work_queue, buffer->height, 32, RenderWeirdGradientRows, &work);
+}
+
+void GameDrawPerformanceOverlay(
+        OverlayState* overlay, PlatformFrameStats* stats, PlatformMemoryStats* memory_stats,
+        GameOffscreenBuffer* buffer) {
+    DrawPerformanceOverlay(overlay, stats, memory_stats, buffer);
+}
+
+void GameUpdateAndRender(GameMemory* memory, GameInput* input, GameOffscreenBuffer* buffer) {
+    Assert(sizeof(GameState) <= memory->permanent_storage_size);
+    Assert(sizeof(TransientState) <= memory->transient_storage_size);
+
+    GameState* game_state = static_cast<GameState*>(memory->permanent_storage);
+    TransientState* transient_state = static_cast<TransientState*>(memory->transient_storage);
+
+    if(!game_state->is_initialized) {
+        InitializeArena(
+            &game_state->world_arena, memory->permanent_storage_size - sizeof(GameState),
+            static_cast<uint8_t*>(memory->permanent_storage) + sizeof(GameState));
+
+        game_state->is_initialized = true;
+    }
+
+    if(!transient_state->is_initialized) {
+        InitializeArena(
+            &transient_state->transient_arena, memory->transient_storage_size - sizeof(TransientState),
+            static_cast<uint8_t*>(memory->transient_storage) + sizeof(TransientState));
+
+        transient_state->overlay = PushStruct(&transient_state->transient_arena, OverlayState);
+        transient_state->is_initialized = true;
+    }
+
     bool is_up_pressed = false;
     bool is_down_pressed = false;
     bool is_left_pressed = false;
@@ -47,22 +106,30 @@ void GameUpdateAndRender(GameInput* input, GameOffscreenBuffer* buffer) {
     }
 
     if(is_up_pressed) {
-        --g_y_offset;
+        --game_state->y_offset;
     }
 
     if(is_down_pressed) {
-        ++g_y_offset;
+        ++game_state->y_offset;
     }
 
     if(is_left_pressed) {
-        --g_x_offset;
+        --game_state->x_offset;
     }
 
     if(is_right_pressed) {
-        ++g_x_offset;
+        ++game_state->x_offset;
     }
 
-    RenderWeirdGradient(buffer, g_x_offset, g_y_offset);
+    RenderWeirdGradient(&memory->platform, buffer, game_state->x_offset, game_state->y_offset);
+
+    GameDrawPerformanceOverlay(transient_state->overlay, &memory->frame_stats, &memory->memory_stats, buffer);
+
+    CheckArena(&game_state->world_arena);
+    CheckArena(&transient_state->transient_arena);
+
+    ReportArena(&memory->memory_stats, "World", &game_state->world_arena);
+    ReportArena(&memory->memory_stats, "Transient", &transient_state->transient_arena);
 }
 
 void GameGetSoundSamples() {
@@ -0,0 +1,213 @@
+#ifndef WATCHER_COMPRESSION_H
+#define WATCHER_COMPRESSION_H
+
+// Small LZ77 codec in the style of LZ4, tuned for compressing single pages of memory quickly.
+//
+// A compressed stream is a sequence of sequences. Each starts with a token byte: the high nibble is
+// the literal count and the low nibble is the match length minus LZ_MIN_MATCH, where a nibble of 15
+// means more length bytes follow (each adds up to 255, stopping at the first byte below 255). The
+// literals come next, then a 2-byte little-endian match offset. The final sequence has literals only.
+
+#include <string.h>
+
+#include "watcher_platform.h"
+
+#define LZ_MIN_MATCH 4
+#define LZ_MAX_OFFSET 65535
+
+// Note: Matches never start within the last LZ_LAST_LITERALS bytes, which keeps the decoder simple
+#define LZ_LAST_LITERALS 5
+
+// Note: Inputs are limited so positions fit in the 16-bit hash table
+#define LZ_MAX_SOURCE_SIZE 65536
+
+#define LZ_HASH_BITS 10
+#define LZ_HASH_COUNT (1 << LZ_HASH_BITS)
+
+#define LzMaxCompressedSize(source_size) ((source_size) + (source_size) / 255 + 16)
+
+// Note: Positions are byte aligned, so this goes through memcpy, which compiles to a single load
+inline uint32_t LzRead32(uint8_t* at) {
+    uint32_t result;
+    memcpy(&result, at, sizeof(result));
+
+    return result;
+}
+
+inline uint32_t LzHash(uint32_t sequence) {
+    uint32_t result = (sequence * 2654435761u) >> (32 - LZ_HASH_BITS);
+
+    return result;
+}
+
+inline uint8_t* LzWriteLength(uint8_t* dest, uint32_t length) {
+    while(length >= 255) {
+        *dest++ = 255;
+        length -= 255;
+    }
+
+    *dest++ = static_cast<uint8_t>(length);
+
+    return dest;
+}
+
+inline uint8_t* LzWriteLiterals(uint8_t* dest, uint8_t* token, uint8_t* literals, uint32_t literal_count) {
+    if(literal_count >= 15) {
+        *token = 15 << 4;
+        dest = LzWriteLength(dest, literal_count - 15);
+    } else {
+        *token = static_cast<uint8_t>(literal_count << 4);
+    }
+
+    for(uint32_t index = 0; index < literal_count; ++index) {
+        *dest++ = literals[index];
+    }
+
+    return dest;
+}
+
+// Returns the compressed size. dest must hold LzMaxCompressedSize(source_size) bytes.
+internal uint32_t LzCompress(void* source_memory, uint32_t source_size, void* dest_memory) {
+    Assert(source_size <= LZ_MAX_SOURCE_SIZE);
+
+    uint8_t* source = static_cast<uint8_t*>(source_memory);
+    uint8_t* dest = static_cast<uint8_t*>(dest_memory);
+
+    // Note: Positions are stored plus one, so zero means empty
+    uint16_t table[LZ_HASH_COUNT];
+    for(int index = 0; index < LZ_HASH_COUNT; ++index) {
+        table[index] = 0;
+    }
+
+    uint32_t anchor = 0;
+    uint32_t position = 0;
+    uint32_t miss_count = 0;
+
+    if(source_size > LZ_MIN_MATCH + LZ_LAST_LITERALS) {
+        uint32_t match_limit = source_size - LZ_LAST_LITERALS;
+
+        while(position + LZ_MIN_MATCH <= match_limit) {
+            uint32_t sequence = LzRead32(source + position);
+            uint32_t hash = LzHash(sequence);
+            uint32_t candidate = table[hash];
+            table[hash] = static_cast<uint16_t>(position + 1);
+
+            if(candidate == 0 || LzRead32(source + candidate - 1) != sequence) {
+                // Note: Skip ahead faster through incompressible data
+                position += 1 + (miss_count++ >> 5);
+                continue;
+            }
+
+            uint32_t match_position = candidate - 1;
+            uint32_t match_length = LZ_MIN_MATCH;
+
+            while(position + match_length < match_limit &&
+                    source[match_position + match_length] == source[position + match_length]) {
+                ++match_length;
+            }
+
+            uint8_t* token = dest++;
+            dest = LzWriteLiterals(dest, token, source + anchor, position - anchor);
+
+            uint32_t offset = position - match_position;
+            *dest++ = static_cast<uint8_t>(offset);
+            *dest++ = static_cast<uint8_t>(offset >> 8);
+
+            uint32_t extra_length = match_length - LZ_MIN_MATCH;
+            if(extra_length >= 15) {
+                *token |= 15;
+                dest = LzWriteLength(dest, extra_length - 15);
+            } else {
+                *token |= static_cast<uint8_t>(extra_length);
+            }
+
+            position += match_length;
+            anchor = position;
+            miss_count = 0;
+        }
+    }
+
+    uint8_t* token = dest++;
+    dest = LzWriteLiterals(dest, token, source + anchor, source_size - anchor);
+
+    uint32_t result = static_cast<uint32_t>(dest - static_cast<uint8_t*>(dest_memory));
+
+    return result;
+}
+
+inline bool32 LzReadLength(uint8_t** at, uint8_t* end, uint32_t* length) {
+    uint8_t value;
+
+    do {
+        if(*at >= end) {
+            return false;
+        }
+
+        value = *(*at)++;
+        *length += value;
+    } while(value == 255);
+
+    return true;
+}
+
+// Returns false unless the stream is well formed and decodes to exactly dest_size bytes
+internal bool32 LzDecompress(void* source_memory, uint32_t source_size, void* dest_memory, uint32_t dest_size) {
+    uint8_t* source = static_cast<uint8_t*>(source_memory);
+    uint8_t* source_end = source + source_size;
+    uint8_t* dest_base = static_cast<uint8_t*>(dest_memory);
+    uint8_t* dest = dest_base;
+    uint8_t* dest_end = dest_base + dest_size;
+
+    while(source < source_end) {
+        uint8_t token = *source++;
+
+        uint32_t literal_count = token >> 4;
+        if(literal_count == 15 && !LzReadLength(&source, source_end, &literal_count)) {
+            return false;
+        }
+
+        if(literal_count > static_cast<uint32_t>(source_end - source) ||
+                literal_count > static_cast<uint32_t>(dest_end - dest)) {
+            return false;
+        }
+
+        for(uint32_t index = 0; index < literal_count; ++index) {
+            *dest++ = *source++;
+        }
+
+        if(source == source_end) {
+            break;
+        }
+
+        if(source_end - source < 2) {
+            return false;
+        }
+
+        uint32_t offset = source[0] | (source[1] << 8);
+        source += 2;
+
+        uint32_t match_length = token & 15;
+        if(match_length == 15 && !LzReadLength(&source, source_end, &match_length)) {
+            return false;
+        }
+
+        match_length += LZ_MIN_MATCH;
+
+        if(offset == 0 || offset > static_cast<uint32_t>(dest - dest_base) ||
+                match_length > static_cast<uint32_t>(dest_end - dest)) {
+            return false;
+        }
+
+        // Note: Byte at a time, since a match may overlap the bytes it is producing
+        uint8_t* match = dest - offset;
+        for(uint32_t index = 0; index < match_length; ++index) {
+            *dest++ = *match++;
+        }
+    }
+
+    bool32 result = dest == dest_end;
+
+    return result;
+}
+
+#endif  // !WATCHER_COMPRESSION_H
@@ -0,0 +1,311 @@
+// Test for the page codec in watcher_compression.h. Nothing in it is platform specific, so it builds
+// anywhere:
+//
+//     g++ -O2 -DNAMELESS_WATCHER_SLOW=1 watcher_compression_test.cpp -o watcher_compression_test
+//
+// It's worth running under -fsanitize=address,undefined as well, which catches reads or writes past
+// either buffer, and unaligned loads, that a plain build would get away with.
+//
+// Every kind of page the checkpointer is likely to see (empty, sparse, repetitive, noise, and mixes of
+// them) has to come back out exactly as it went in, from any alignment, without the compressed size
+// going over LzMaxCompressedSize. Truncated, corrupted and made-up streams have to be rejected without
+// writing outside the destination.
+
+#include <stdio.h>
+#include <string.h>
+
+#include "watcher_compression.h"
+
+#define TEST_GUARD_SIZE 64
+#define TEST_GUARD_VALUE 0xA5
+#define TEST_RANDOM_SOURCE_COUNT 2000
+#define TEST_GARBAGE_STREAM_COUNT 200000
+
+global_variable uint8_t g_source[LZ_MAX_SOURCE_SIZE + 8];
+global_variable uint8_t g_compressed[LzMaxCompressedSize(LZ_MAX_SOURCE_SIZE) + TEST_GUARD_SIZE];
+global_variable uint8_t g_decompressed[LZ_MAX_SOURCE_SIZE + TEST_GUARD_SIZE];
+
+global_variable uint32_t g_random_state = 0x12345678;
+
+internal uint32_t GetTestRandom() {
+    // Note: xorshift32, so the test runs the same everywhere
+    g_random_state ^= g_random_state << 13;
+    g_random_state ^= g_random_state >> 17;
+    g_random_state ^= g_random_state << 5;
+
+    return g_random_state;
+}
+
+internal bool32 GuardIsIntact(uint8_t* guard) {
+    for(int index = 0; index < TEST_GUARD_SIZE; ++index) {
+        if(guard[index] != TEST_GUARD_VALUE) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// Note: Fills size bytes the way one of the kinds of page would look
+internal void FillTestSource(uint8_t* source, uint32_t size, uint32_t kind) {
+    switch(kind % 6) {
+        case 0: {
+            memset(source, 0, size);
+        } break;
+
+        case 1: {
+            // Note: Mostly zero, with a few values scattered about, like a lightly used arena
+            memset(source, 0, size);
+            for(uint32_t index = 0; index < size / 64; ++index) {
+                source[GetTestRandom() % size] = static_cast<uint8_t>(GetTestRandom());
+            }
+        } break;
+
+        case 2: {
+            // Note: An array of small structs that differ a little from one to the next
+            for(uint32_t index = 0; index < size; ++index) {
+                source[index] = static_cast<uint8_t>((index % 24) + (index / 24) % 3);
+            }
+        } break;
+
+        case 3: {
+            for(uint32_t index = 0; index < size; ++index) {
+                source[index] = static_cast<uint8_t>(GetTestRandom());
+            }
+        } break;
+
+        case 4: {
+            // Note: Runs of noise and runs of repeats, which covers long literal and match lengths
+            uint32_t index = 0;
+            while(index < size) {
+                uint32_t run = 1 + GetTestRandom() % 700;
+                uint8_t value = static_cast<uint8_t>(GetTestRandom());
+                bool32 is_noise = GetTestRandom() & 1;
+
+                for(; run && index < size; --run, ++index) {
+                    source[index] = is_noise ? static_cast<uint8_t>(GetTestRandom()) : value;
+                }
+            }
+        } break;
+
+        case 5: {
+            // Note: Only a handful of distinct bytes, so matches turn up at every distance
+            for(uint32_t index = 0; index < size; ++index) {
+                source[index] = static_cast<uint8_t>(GetTestRandom() % 3);
+            }
+        } break;
+    }
+}
+
+// Note: Compresses and decompresses size bytes starting at g_source + alignment, returning the
+// compressed size, or zero on any failure
+internal uint32_t RoundTrip(uint32_t alignment, uint32_t size) {
+    uint8_t* source = g_source + alignment;
+
+    memset(g_compressed, TEST_GUARD_VALUE, sizeof(g_compressed));
+    memset(g_decompressed, TEST_GUARD_VALUE, sizeof(g_decompressed));
+
+    uint32_t compressed_size = LzCompress(source, size, g_compressed);
+
+    if(compressed_size == 0 || compressed_size > LzMaxCompressedSize(size)) {
+        printf("%u bytes compressed to %u, over the %u maximum\n",
+            size, compressed_size, static_cast<uint32_t>(LzMaxCompressedSize(size)));
+        return 0;
+    }
+
+    if(!GuardIsIntact(g_compressed + compressed_size)) {
+        printf("Compressing %u bytes wrote past the compressed size\n", size);
+        return 0;
+    }
+
+    if(!LzDecompress(g_compressed, compressed_size, g_decompressed, size) ||
+            memcmp(source, g_decompressed, size) != 0) {
+        printf("%u bytes didn't come back out as they went in\n", size);
+        return 0;
+    }
+
+    if(!GuardIsIntact(g_decompressed + size)) {
+        printf("Decompressing %u bytes wrote past the end\n", size);
+        return 0;
+    }
+
+    return compressed_size;
+}
+
+internal bool32 RunRoundTripTest() {
+    bool32 result = true;
+
+    // Note: Sizes around the edges of what the compressor treats specially, at every alignment
+    uint32_t edge_sizes[] = {
+        0, 1, 4, 5, 8, 9, 10, 15, 16, 17, 19, 20, 21, 255, 256, 269, 270, 4095, 4096, 65535, LZ_MAX_SOURCE_SIZE};
+
+    for(uint32_t kind = 0; kind < 6 && result; ++kind) {
+        for(uint32_t size_index = 0; size_index < sizeof(edge_sizes) / sizeof(edge_sizes[0]) && result; ++size_index) {
+            for(uint32_t alignment = 0; alignment < 8 && result; ++alignment) {
+                uint32_t size = edge_sizes[size_index];
+                FillTestSource(g_source + alignment, size, kind);
+
+                if(size && !RoundTrip(alignment, size)) {
+                    printf("Kind %u, size %u, alignment %u\n", kind, size, alignment);
+                    result = false;
+                }
+            }
+        }
+    }
+
+    for(uint32_t test_index = 0; test_index < TEST_RANDOM_SOURCE_COUNT && result; ++test_index) {
+        uint32_t size = 1 + GetTestRandom() % LZ_MAX_SOURCE_SIZE;
+        uint32_t alignment = GetTestRandom() % 8;
+        uint32_t kind = GetTestRandom();
+        FillTestSource(g_source + alignment, size, kind);
+
+        if(!RoundTrip(alignment, size)) {
+            printf("Kind %u, size %u, alignment %u\n", kind % 6, size, alignment);
+            result = false;
+        }
+    }
+
+    // Note: A zeroed page is by far the most common, and has to shrink to almost nothing
+    memset(g_source, 0, 4096);
+    uint32_t zero_page_size = RoundTrip(0, 4096);
+    if(!zero_page_size || zero_page_size > 32) {
+        printf("A zeroed page compressed to %u bytes\n", zero_page_size);
+        result = false;
+    }
+
+    return result;
+}
+
+internal bool32 RunMalformedStreamTest() {
+    bool32 result = true;
+
+    uint32_t size = 4096;
+
+    for(uint32_t kind = 0; kind < 6 && result; ++kind) {
+        FillTestSource(g_source, size, kind);
+        uint32_t compressed_size = RoundTrip(0, size);
+
+        if(!compressed_size) {
+            result = false;
+            break;
+        }
+
+        // Note: Every truncation of a good stream decodes to too few bytes, or runs off the end
+        for(uint32_t truncated_size = 0; truncated_size < compressed_size; ++truncated_size) {
+            memset(g_decompressed, TEST_GUARD_VALUE, sizeof(g_decompressed));
+
+            if(LzDecompress(g_compressed, truncated_size, g_decompressed, size)) {
+                printf("Kind %u truncated to %u of %u bytes was accepted\n", kind, truncated_size, compressed_size);
+                result = false;
+                break;
+            }
+
+            if(!GuardIsIntact(g_decompressed + size)) {
+                printf("Kind %u truncated to %u bytes wrote past the end\n", kind, truncated_size);
+                result = false;
+                break;
+            }
+        }
+
+        // Note: A good stream with the wrong expected size is rejected either way, without overrunning
+        memset(g_decompressed, TEST_GUARD_VALUE, sizeof(g_decompressed));
+        if(LzDecompress(g_compressed, compressed_size, g_decompressed, size - 1) ||
+                !GuardIsIntact(g_decompressed + size - 1) ||
+                LzDecompress(g_compressed, compressed_size, g_decompressed, size + 1)) {
+            printf("Kind %u was accepted at the wrong size\n", kind);
+            result = false;
+        }
+
+        // Note: Single flipped bits mostly still decode to something, but must never overrun
+        for(uint32_t flip_index = 0; flip_index < 2000 && result; ++flip_index) {
+            FillTestSource(g_source, size, kind);
+            compressed_size = LzCompress(g_source, size, g_compressed);
+
+            g_compressed[GetTestRandom() % compressed_size] ^= static_cast<uint8_t>(1 << (GetTestRandom() % 8));
+
+            memset(g_decompressed, TEST_GUARD_VALUE, sizeof(g_decompressed));
+            LzDecompress(g_compressed, compressed_size, g_decompressed, size);
+
+            if(!GuardIsIntact(g_decompressed + size)) {
+                printf("Kind %u with a flipped bit wrote past the end\n", kind);
+                result = false;
+            }
+        }
+    }
+
+    // Note: Hand-made streams that break one rule each
+    uint8_t zero_offset[] = {0x10, 'a', 0x00, 0x00, 0x00};
+    uint8_t offset_too_far[] = {0x10, 'a', 0x02, 0x00, 0x00};
+    uint8_t missing_offset_byte[] = {0x10, 'a', 0x01};
+    uint8_t missing_literal_length[] = {0xF0};
+    uint8_t unfinished_literal_length[] = {0xF0, 0xFF, 0xFF};
+    uint8_t missing_match_length[] = {0x1F, 'a', 0x01, 0x00};
+    uint8_t literals_past_end[] = {0x50, 'a', 'b'};
+    uint8_t match_past_end[] = {0x1F, 'a', 0x01, 0x00, 0xFF, 0xFF, 0xFF, 0x10, 'b'};
+
+    struct MalformedStream {
+        const char* name;
+        uint8_t* stream;
+        uint32_t stream_size;
+    };
+
+    MalformedStream streams[] = {
+        {"Zero offset", zero_offset, sizeof(zero_offset)},
+        {"Offset before the start", offset_too_far, sizeof(offset_too_far)},
+        {"Missing offset byte", missing_offset_byte, sizeof(missing_offset_byte)},
+        {"Missing literal length", missing_literal_length, sizeof(missing_literal_length)},
+        {"Unfinished literal length", unfinished_literal_length, sizeof(unfinished_literal_length)},
+        {"Missing match length", missing_match_length, sizeof(missing_match_length)},
+        {"Literals past the end of the stream", literals_past_end, sizeof(literals_past_end)},
+        {"Match past the end of the output", match_past_end, sizeof(match_past_end)},
+    };
+
+    for(uint32_t stream_index = 0; stream_index < sizeof(streams) / sizeof(streams[0]); ++stream_index) {
+        MalformedStream* malformed = &streams[stream_index];
+        memset(g_decompressed, TEST_GUARD_VALUE, sizeof(g_decompressed));
+
+        if(LzDecompress(malformed->stream, malformed->stream_size, g_decompressed, 16) ||
+                !GuardIsIntact(g_decompressed + 16)) {
+            printf("%s was accepted\n", malformed->name);
+            result = false;
+        }
+    }
+
+    return result;
+}
+
+internal bool32 RunGarbageStreamTest() {
+    bool32 result = true;
+
+    for(uint32_t test_index = 0; test_index < TEST_GARBAGE_STREAM_COUNT && result; ++test_index) {
+        uint32_t stream_size = GetTestRandom() % 64;
+        uint32_t dest_size = GetTestRandom() % 256;
+
+        for(uint32_t index = 0; index < stream_size; ++index) {
+            g_compressed[index] = static_cast<uint8_t>(GetTestRandom());
+        }
+
+        memset(g_decompressed, TEST_GUARD_VALUE, sizeof(g_decompressed));
+        LzDecompress(g_compressed, stream_size, g_decompressed, dest_size);
+
+        if(!GuardIsIntact(g_decompressed + dest_size)) {
+            printf("A %u byte garbage stream wrote past %u bytes of output\n", stream_size, dest_size);
+            result = false;
+        }
+    }
+
+    return result;
+}
+
+int main() {
+    bool32 round_trip_passed = RunRoundTripTest();
+    printf("Round trip, %u random sources: %s\n", TEST_RANDOM_SOURCE_COUNT, round_trip_passed ? "passed" : "FAILED");
+
+    bool32 malformed_passed = RunMalformedStreamTest();
+    printf("Malformed streams: %s\n", malformed_passed ? "passed" : "FAILED");
+
+    bool32 garbage_passed = RunGarbageStreamTest();
+    printf("Garbage, %u streams: %s\n", TEST_GARBAGE_STREAM_COUNT, garbage_passed ? "passed" : "FAILED");
+
+    return round_trip_passed && malformed_passed && garbage_passed ? 0 : 1;
+}
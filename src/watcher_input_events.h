@@ -0,0 +1,145 @@
+#ifndef WATCHER_INPUT_EVENTS_H
+#define WATCHER_INPUT_EVENTS_H
+
+// Queue of raw input transitions, handed from the thread that owns the window to the thread that runs
+// the game.
+//
+// The queue is a single-producer, single-consumer ring buffer with no locks: only the window thread
+// pushes and only the simulation thread pops. Once a frame the simulation thread drains it into that
+// frame's GameInput, counting every transition, so a key tapped twice within one frame still shows up
+// as four half transitions.
+
+#include <stddef.h>
+
+#include "watcher_platform.h"
+
+// Note: Each side publishes its index with a release store and reads the other side's with an
+// acquire load. That's what keeps the consumer from seeing a new write_index before the event behind
+// it, and the producer from reusing a slot before the consumer is done copying it out.
+#if defined(_MSC_VER)
+#include <intrin.h>
+
+// Note: The platform layer only targets x86 and x64, where ordinary loads already acquire and
+// ordinary stores already release, so only the compiler has to be kept from reordering
+inline uint32_t InputEventLoadAcquire(uint32_t volatile* value) {
+    uint32_t result = *value;
+    _ReadWriteBarrier();
+
+    return result;
+}
+
+inline void InputEventStoreRelease(uint32_t volatile* value, uint32_t new_value) {
+    _ReadWriteBarrier();
+    *value = new_value;
+}
+#else
+inline uint32_t InputEventLoadAcquire(uint32_t volatile* value) {
+    uint32_t result = __atomic_load_n(value, __ATOMIC_ACQUIRE);
+
+    return result;
+}
+
+inline void InputEventStoreRelease(uint32_t volatile* value, uint32_t new_value) {
+    __atomic_store_n(value, new_value, __ATOMIC_RELEASE);
+}
+#endif
+
+// Note: Must be a power of two
+#define INPUT_EVENT_QUEUE_SIZE 1024
+
+#define ControllerButtonIndex(button_name) static_cast<uint32_t>( \
+    (offsetof(GameControllerInput, button_name) - offsetof(GameControllerInput, buttons)) / sizeof(GameButtonState))
+
+enum InputEventType {
+    InputEventType_ControllerButton,  // index is a button in GameControllerInput::buttons
+    InputEventType_MouseButton,  // index is a button in GameInput::mouse_buttons
+    InputEventType_Command,  // index means whatever the platform wants, it's passed back untouched
+};
+
+struct InputEvent {
+    uint32_t type;
+    uint32_t index;
+    bool32 is_down;
+};
+
+struct InputEventQueue {
+    uint32_t volatile write_index;
+    uint8_t write_padding[64 - sizeof(uint32_t)];  // Keep producer and consumer off each other's cache line
+
+    uint32_t volatile read_index;
+    uint8_t read_padding[64 - sizeof(uint32_t)];
+
+    InputEvent events[INPUT_EVENT_QUEUE_SIZE];
+};
+
+// Note: Producer only. Returns false if the queue is full, in which case nothing was pushed.
+internal bool32 PushInputEvent(InputEventQueue* queue, InputEvent* event) {
+    uint32_t write_index = queue->write_index;
+
+    if(write_index - InputEventLoadAcquire(&queue->read_index) >= INPUT_EVENT_QUEUE_SIZE) {
+        return false;
+    }
+
+    queue->events[write_index & (INPUT_EVENT_QUEUE_SIZE - 1)] = *event;
+
+    InputEventStoreRelease(&queue->write_index, write_index + 1);
+
+    return true;
+}
+
+// Note: Consumer only
+internal bool32 PopInputEvent(InputEventQueue* queue, InputEvent* event) {
+    uint32_t read_index = queue->read_index;
+
+    if(read_index == InputEventLoadAcquire(&queue->write_index)) {
+        return false;
+    }
+
+    *event = queue->events[read_index & (INPUT_EVENT_QUEUE_SIZE - 1)];
+
+    InputEventStoreRelease(&queue->read_index, read_index + 1);
+
+    return true;
+}
+
+inline void ApplyInputButtonEvent(GameButtonState* new_state, bool32 is_down) {
+    if(new_state->ended_down != is_down) {
+        new_state->ended_down = is_down;
+        ++new_state->half_transition_count;
+    }
+}
+
+// Note: Consumer only. Folds button events into keyboard_controller and mouse_buttons, and copies
+// command events out to commands in the order they arrived. Stops early if commands fills up, leaving
+// the rest for next time. Returns the number of commands copied out.
+internal uint32_t DrainInputEvents(
+        InputEventQueue* queue, GameControllerInput* keyboard_controller, GameButtonState* mouse_buttons,
+        InputEvent* commands, uint32_t max_command_count) {
+    uint32_t command_count = 0;
+    InputEvent event;
+
+    while(command_count < max_command_count && PopInputEvent(queue, &event)) {
+        switch(event.type) {
+            case InputEventType_ControllerButton: {
+                Assert(event.index < NUM_SUPPORTED_CONTROLLER_BUTTONS);
+                ApplyInputButtonEvent(&keyboard_controller->buttons[event.index], event.is_down);
+                break;
+            }
+
+            case InputEventType_MouseButton: {
+                Assert(event.index < NUM_SUPPORTED_MOUSE_BUTTONS);
+                ApplyInputButtonEvent(&mouse_buttons[event.index], event.is_down);
+                break;
+            }
+
+            case InputEventType_Command: {
+                commands[command_count++] = event;
+                break;
+            }
+        }
+    }
+
+    return command_count;
+}
+
+#endif  // !WATCHER_INPUT_EVENTS_H
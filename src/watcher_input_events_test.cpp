@@ -0,0 +1,200 @@
+// Stress test for the input event queue in watcher_input_events.h. Needs pthreads, so it's meant for
+// Linux (or anything else POSIX); the queue itself doesn't care which platform it's on.
+//
+//     g++ -O2 -pthread -DNAMELESS_WATCHER_SLOW=1 watcher_input_events_test.cpp -o watcher_input_events_test
+//
+// It's worth running under -fsanitize=thread as well, which catches unordered access to the queue's
+// indices even on x86, where the hardware would hide it.
+//
+// A producer thread pushes a long, deterministic stream of events while the main thread consumes it,
+// first one event at a time (every event has to come out exactly as it went in, in order), then
+// frame by frame through DrainInputEvents (every transition has to be counted, and commands have to
+// come out in order even when a frame can't take all of them).
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+
+#include "watcher_input_events.h"
+
+#define TEST_EVENT_COUNT 4000000
+#define TEST_COMMAND_INTERVAL 97
+#define TEST_MAX_COMMANDS_PER_FRAME 4
+
+global_variable InputEventQueue g_queue;
+
+// Note: The index'th event of the stream. Buttons are toggled in a pattern that sometimes repeats
+// the current state, so the drain has to skip those instead of counting them.
+internal InputEvent GetTestEvent(uint32_t index) {
+    InputEvent result = {};
+
+    uint32_t hash = index * 2654435761u;
+
+    if(index % TEST_COMMAND_INTERVAL == TEST_COMMAND_INTERVAL - 1) {
+        result.type = InputEventType_Command;
+        result.index = index;
+        result.is_down = true;
+    } else if(hash & 0x100) {
+        result.type = InputEventType_MouseButton;
+        result.index = (hash >> 12) % NUM_SUPPORTED_MOUSE_BUTTONS;
+        result.is_down = (hash >> 20) & 1;
+    } else {
+        result.type = InputEventType_ControllerButton;
+        result.index = (hash >> 12) % NUM_SUPPORTED_CONTROLLER_BUTTONS;
+        result.is_down = (hash >> 20) & 1;
+    }
+
+    return result;
+}
+
+internal void* ProduceTestEvents(void* parameter) {
+    for(uint32_t index = 0; index < TEST_EVENT_COUNT; ++index) {
+        InputEvent event = GetTestEvent(index);
+
+        while(!PushInputEvent(&g_queue, &event)) {
+            sched_yield();
+        }
+    }
+
+    return 0;
+}
+
+internal bool32 RunExactOrderTest() {
+    g_queue = {};
+
+    pthread_t producer;
+    pthread_create(&producer, 0, ProduceTestEvents, 0);
+
+    bool32 result = true;
+    uint32_t index = 0;
+
+    while(index < TEST_EVENT_COUNT) {
+        InputEvent event;
+
+        if(!PopInputEvent(&g_queue, &event)) {
+            sched_yield();
+            continue;
+        }
+
+        InputEvent expected = GetTestEvent(index);
+
+        if(event.type != expected.type || event.index != expected.index || event.is_down != expected.is_down) {
+            printf("Event %u came out as %u/%u/%d\n", index, event.type, event.index, event.is_down);
+            result = false;
+            break;
+        }
+
+        ++index;
+    }
+
+    pthread_join(producer, 0);
+
+    return result;
+}
+
+internal bool32 RunDrainTest() {
+    g_queue = {};
+
+    // Note: What the drain should add up to, worked out without the queue
+    GameControllerInput expected_keyboard = {};
+    GameButtonState expected_mouse_buttons[NUM_SUPPORTED_MOUSE_BUTTONS] = {};
+    uint64_t expected_transition_count = 0;
+
+    for(uint32_t index = 0; index < TEST_EVENT_COUNT; ++index) {
+        InputEvent event = GetTestEvent(index);
+
+        GameButtonState* button = 0;
+        if(event.type == InputEventType_ControllerButton) {
+            button = &expected_keyboard.buttons[event.index];
+        } else if(event.type == InputEventType_MouseButton) {
+            button = &expected_mouse_buttons[event.index];
+        }
+
+        if(button && button->ended_down != event.is_down) {
+            button->ended_down = event.is_down;
+            ++expected_transition_count;
+        }
+    }
+
+    pthread_t producer;
+    pthread_create(&producer, 0, ProduceTestEvents, 0);
+
+    GameControllerInput keyboard = {};
+    GameButtonState mouse_buttons[NUM_SUPPORTED_MOUSE_BUTTONS] = {};
+    InputEvent commands[TEST_MAX_COMMANDS_PER_FRAME];
+
+    bool32 result = true;
+    uint64_t transition_count = 0;
+    uint32_t command_count = 0;
+    uint32_t expected_command_count = TEST_EVENT_COUNT / TEST_COMMAND_INTERVAL;
+    uint32_t next_command_index = TEST_COMMAND_INTERVAL - 1;
+
+    while(result && (command_count < expected_command_count || g_queue.read_index != TEST_EVENT_COUNT)) {
+        // Note: Same as the platform does at the start of every frame
+        for(int button_index = 0; button_index < NUM_SUPPORTED_CONTROLLER_BUTTONS; ++button_index) {
+            keyboard.buttons[button_index].half_transition_count = 0;
+        }
+
+        for(int button_index = 0; button_index < NUM_SUPPORTED_MOUSE_BUTTONS; ++button_index) {
+            mouse_buttons[button_index].half_transition_count = 0;
+        }
+
+        uint32_t frame_command_count =
+            DrainInputEvents(&g_queue, &keyboard, mouse_buttons, commands, TEST_MAX_COMMANDS_PER_FRAME);
+
+        for(uint32_t command_index = 0; command_index < frame_command_count; ++command_index) {
+            if(commands[command_index].index != next_command_index) {
+                printf("Command %u came out as %u\n", next_command_index, commands[command_index].index);
+                result = false;
+            }
+
+            next_command_index += TEST_COMMAND_INTERVAL;
+            ++command_count;
+        }
+
+        for(int button_index = 0; button_index < NUM_SUPPORTED_CONTROLLER_BUTTONS; ++button_index) {
+            transition_count += keyboard.buttons[button_index].half_transition_count;
+        }
+
+        for(int button_index = 0; button_index < NUM_SUPPORTED_MOUSE_BUTTONS; ++button_index) {
+            transition_count += mouse_buttons[button_index].half_transition_count;
+        }
+
+        sched_yield();
+    }
+
+    pthread_join(producer, 0);
+
+    if(transition_count != expected_transition_count) {
+        printf("Counted %llu transitions, expected %llu\n",
+            static_cast<unsigned long long>(transition_count),
+            static_cast<unsigned long long>(expected_transition_count));
+        result = false;
+    }
+
+    for(int button_index = 0; button_index < NUM_SUPPORTED_CONTROLLER_BUTTONS; ++button_index) {
+        if(keyboard.buttons[button_index].ended_down != expected_keyboard.buttons[button_index].ended_down) {
+            printf("Controller button %d ended in the wrong state\n", button_index);
+            result = false;
+        }
+    }
+
+    for(int button_index = 0; button_index < NUM_SUPPORTED_MOUSE_BUTTONS; ++button_index) {
+        if(mouse_buttons[button_index].ended_down != expected_mouse_buttons[button_index].ended_down) {
+            printf("Mouse button %d ended in the wrong state\n", button_index);
+            result = false;
+        }
+    }
+
+    return result;
+}
+
+int main() {
+    bool32 exact_order_passed = RunExactOrderTest();
+    printf("Exact order, %u events: %s\n", TEST_EVENT_COUNT, exact_order_passed ? "passed" : "FAILED");
+
+    bool32 drain_passed = RunDrainTest();
+    printf("Drain, %u events: %s\n", TEST_EVENT_COUNT, drain_passed ? "passed" : "FAILED");
+
+    return exact_order_passed && drain_passed ? 0 : 1;
+}
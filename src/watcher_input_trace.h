@@ -0,0 +1,574 @@
+#ifndef WATCHER_INPUT_TRACE_H
+#define WATCHER_INPUT_TRACE_H
+
+// Packed input trace format, used to record and replay streams of GameInput.
+//
+// A trace file is an InputTraceFileHeader followed by any number of blocks. Each block is an
+// InputTraceBlockHeader followed by payload_size bytes of bit-packed frames. Every block is encoded
+// against a zeroed GameInput, so decoding can start at any block boundary, and each payload carries
+// a checksum so a damaged file is rejected instead of turning into garbage input.
+//
+// Within a frame, a button that did nothing costs one bit, a controller that did nothing costs one
+// bit, mouse coordinates are zig-zag deltas, and stick values on the stick grid (see
+// InputTraceSnapStick) are delta-encoded as grid steps. Values that can't be represented exactly that
+// way are escaped to their raw bits, so decoding always reproduces the exact GameInput that was encoded.
+
+#include "watcher_platform.h"
+
+#define INPUT_TRACE_FILE_MAGIC 0x5457574E  // "NWWT"
+#define INPUT_TRACE_BLOCK_MAGIC 0x4B4C424E  // "NBLK"
+#define INPUT_TRACE_VERSION 1
+
+#define INPUT_TRACE_FRAMES_PER_BLOCK 128
+
+// Note: Upper bound on the encoded size of one frame. A pathological frame (every field changing to
+// a value that needs a maximum-length code) comes to a little over twice sizeof(GameInput).
+#define INPUT_TRACE_MAX_FRAME_SIZE (3 * static_cast<uint32_t>(sizeof(GameInput)))
+#define INPUT_TRACE_MAX_BLOCK_PAYLOAD_SIZE (INPUT_TRACE_FRAMES_PER_BLOCK * INPUT_TRACE_MAX_FRAME_SIZE)
+
+// Note: Stick values are stored as multiples of 1 / INPUT_TRACE_STICK_SCALE. That's as fine as XInput
+// reports them, so snapping to it loses nothing the hardware could tell apart.
+#define INPUT_TRACE_STICK_SCALE 32767.0f
+
+struct InputTraceFileHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t frames_per_block;
+    uint32_t input_size;  // sizeof(GameInput) of the recording build
+};
+
+struct InputTraceBlockHeader {
+    uint32_t magic;
+    uint32_t first_frame_index;
+    uint32_t frame_count;
+    uint32_t payload_size;
+    uint32_t checksum;
+};
+
+struct InputTraceBitWriter {
+    uint8_t* base;
+    uint32_t capacity;
+    uint32_t size;
+
+    uint64_t bit_buffer;
+    uint32_t bit_count;
+};
+
+struct InputTraceBitReader {
+    uint8_t* base;
+    uint32_t size;
+    uint32_t position;
+
+    uint64_t bit_buffer;
+    uint32_t bit_count;
+
+    bool32 is_overrun;
+};
+
+struct InputTraceEncoder {
+    InputTraceBitWriter writer;
+    GameInput previous;
+
+    uint32_t first_frame_index;
+    uint32_t frame_count;
+};
+
+struct InputTraceDecoder {
+    InputTraceBitReader reader;
+    GameInput previous;
+
+    uint32_t next_frame_index;
+    uint32_t frames_remaining;
+};
+
+inline uint32_t InputTraceChecksum(uint8_t* data, uint32_t size) {
+    // Note: FNV-1a
+    uint32_t result = 2166136261u;
+
+    for(uint32_t index = 0; index < size; ++index) {
+        result ^= data[index];
+        result *= 16777619u;
+    }
+
+    return result;
+}
+
+inline uint32_t InputTraceFloatBits(float32 value) {
+    union {
+        float32 f;
+        uint32_t u;
+    } result;
+    result.f = value;
+
+    return result.u;
+}
+
+inline float32 InputTraceBitsToFloat(uint32_t value) {
+    union {
+        float32 f;
+        uint32_t u;
+    } result;
+    result.u = value;
+
+    return result.f;
+}
+
+inline uint32_t InputTraceZigZag(int32_t value) {
+    uint32_t result = (static_cast<uint32_t>(value) << 1) ^ static_cast<uint32_t>(value >> 31);
+
+    return result;
+}
+
+inline int32_t InputTraceUnZigZag(uint32_t value) {
+    int32_t result = static_cast<int32_t>((value >> 1) ^ (0u - (value & 1)));
+
+    return result;
+}
+
+//
+// Bit I/O
+//
+
+internal void InputTraceWriteBits(InputTraceBitWriter* writer, uint32_t value, uint32_t count) {
+    Assert(count <= 32);
+
+    uint64_t mask = (static_cast<uint64_t>(1) << count) - 1;
+    writer->bit_buffer |= (value & mask) << writer->bit_count;
+    writer->bit_count += count;
+
+    while(writer->bit_count >= 8) {
+        Assert(writer->size < writer->capacity);
+        writer->base[writer->size++] = static_cast<uint8_t>(writer->bit_buffer);
+        writer->bit_buffer >>= 8;
+        writer->bit_count -= 8;
+    }
+}
+
+internal void InputTraceFlushBits(InputTraceBitWriter* writer) {
+    if(writer->bit_count > 0) {
+        Assert(writer->size < writer->capacity);
+        writer->base[writer->size++] = static_cast<uint8_t>(writer->bit_buffer);
+        writer->bit_buffer = 0;
+        writer->bit_count = 0;
+    }
+}
+
+internal uint32_t InputTraceReadBits(InputTraceBitReader* reader, uint32_t count) {
+    Assert(count <= 32);
+
+    while(reader->bit_count < count) {
+        uint64_t next_byte = 0;
+
+        if(reader->position < reader->size) {
+            next_byte = reader->base[reader->position++];
+        } else {
+            reader->is_overrun = true;
+        }
+
+        reader->bit_buffer |= next_byte << reader->bit_count;
+        reader->bit_count += 8;
+    }
+
+    uint64_t mask = (static_cast<uint64_t>(1) << count) - 1;
+    uint32_t result = static_cast<uint32_t>(reader->bit_buffer & mask);
+    reader->bit_buffer >>= count;
+    reader->bit_count -= count;
+
+    return result;
+}
+
+// Note: Exp-Golomb code, so small values (which is nearly everything in a frame delta) take few bits
+internal void InputTraceWriteUnsigned(InputTraceBitWriter* writer, uint32_t value) {
+    uint64_t biased_value = static_cast<uint64_t>(value) + 1;
+
+    uint32_t prefix_count = 0;
+    while((biased_value >> (prefix_count + 1)) != 0) {
+        ++prefix_count;
+    }
+
+    InputTraceWriteBits(writer, 0, prefix_count > 31 ? 31 : prefix_count);
+    if(prefix_count > 31) {
+        InputTraceWriteBits(writer, 0, prefix_count - 31);
+    }
+
+    InputTraceWriteBits(writer, 1, 1);
+    InputTraceWriteBits(writer, static_cast<uint32_t>(biased_value), prefix_count);
+}
+
+internal uint32_t InputTraceReadUnsigned(InputTraceBitReader* reader) {
+    uint32_t prefix_count = 0;
+
+    while(InputTraceReadBits(reader, 1) == 0) {
+        ++prefix_count;
+
+        if(prefix_count > 32 || reader->is_overrun) {
+            reader->is_overrun = true;
+            return 0;
+        }
+    }
+
+    uint64_t biased_value = (static_cast<uint64_t>(1) << prefix_count) | InputTraceReadBits(reader, prefix_count);
+    uint32_t result = static_cast<uint32_t>(biased_value - 1);
+
+    return result;
+}
+
+internal void InputTraceWriteSigned(InputTraceBitWriter* writer, int32_t value) {
+    InputTraceWriteUnsigned(writer, InputTraceZigZag(value));
+}
+
+internal int32_t InputTraceReadSigned(InputTraceBitReader* reader) {
+    int32_t result = InputTraceUnZigZag(InputTraceReadUnsigned(reader));
+
+    return result;
+}
+
+//
+// Field codecs
+//
+
+// Note: bool32s are usually 0 or 1, but the platform is free to store any non-zero value (e.g. a raw
+// bit mask), and replays have to see the same bits that were recorded
+internal void InputTraceWriteBool32(InputTraceBitWriter* writer, bool32 value, bool32 previous) {
+    if(value == previous) {
+        InputTraceWriteBits(writer, 0, 1);
+    } else {
+        InputTraceWriteBits(writer, 1, 1);
+        InputTraceWriteUnsigned(writer, static_cast<uint32_t>(value));
+    }
+}
+
+internal bool32 InputTraceReadBool32(InputTraceBitReader* reader, bool32 previous) {
+    bool32 result = previous;
+
+    if(InputTraceReadBits(reader, 1)) {
+        result = static_cast<bool32>(InputTraceReadUnsigned(reader));
+    }
+
+    return result;
+}
+
+inline bool32 InputTraceIsButtonQuiet(GameButtonState* button, GameButtonState* previous) {
+    bool32 result = button->half_transition_count == 0 && button->ended_down == previous->ended_down;
+
+    return result;
+}
+
+internal void InputTraceWriteButton(InputTraceBitWriter* writer, GameButtonState* button, GameButtonState* previous) {
+    if(InputTraceIsButtonQuiet(button, previous)) {
+        InputTraceWriteBits(writer, 0, 1);
+    } else {
+        InputTraceWriteBits(writer, 1, 1);
+        InputTraceWriteSigned(writer, button->half_transition_count);
+        InputTraceWriteBool32(writer, button->ended_down, previous->ended_down);
+    }
+}
+
+internal void InputTraceReadButton(InputTraceBitReader* reader, GameButtonState* button, GameButtonState* previous) {
+    button->half_transition_count = 0;
+    button->ended_down = previous->ended_down;
+
+    if(InputTraceReadBits(reader, 1)) {
+        button->half_transition_count = InputTraceReadSigned(reader);
+        button->ended_down = InputTraceReadBool32(reader, previous->ended_down);
+    }
+}
+
+// Note: Nearest step on the stick grid, only meaningful for values in [-1, 1]
+inline int32_t InputTraceRoundStick(float32 value) {
+    float32 scaled_value = value * INPUT_TRACE_STICK_SCALE;
+    int32_t result = static_cast<int32_t>(scaled_value + (scaled_value >= 0.0f ? 0.5f : -0.5f));
+
+    return result;
+}
+
+// Note: Moves a stick value onto the grid, where the encoder stores it as a small delta instead of its
+// raw bits. The platform runs stick values through this before the game or the recorder sees them,
+// so replays still reproduce exactly what the game saw.
+inline float32 InputTraceSnapStick(float32 value) {
+    float32 result = value;
+
+    if(value >= -1.0f && value <= 1.0f) {
+        result = static_cast<float32>(InputTraceRoundStick(value)) / INPUT_TRACE_STICK_SCALE;
+    }
+
+    return result;
+}
+
+// Note: Returns false (and leaves *quantized alone) if value isn't exactly on the stick grid
+internal bool32 InputTraceQuantizeStick(float32 value, int32_t* quantized) {
+    bool32 result = false;
+
+    if(value >= -1.0f && value <= 1.0f) {
+        int32_t rounded_value = InputTraceRoundStick(value);
+        float32 reconstructed_value = static_cast<float32>(rounded_value) / INPUT_TRACE_STICK_SCALE;
+
+        if(InputTraceFloatBits(reconstructed_value) == InputTraceFloatBits(value)) {
+            *quantized = rounded_value;
+            result = true;
+        }
+    }
+
+    return result;
+}
+
+inline int32_t InputTraceNearestStickStep(float32 value) {
+    int32_t result = 0;
+    InputTraceQuantizeStick(value, &result);
+
+    return result;
+}
+
+internal void InputTraceWriteStick(InputTraceBitWriter* writer, float32 value, float32 previous) {
+    int32_t quantized_value;
+
+    if(InputTraceFloatBits(value) == InputTraceFloatBits(previous)) {
+        InputTraceWriteBits(writer, 0, 1);
+    } else if(InputTraceQuantizeStick(value, &quantized_value)) {
+        InputTraceWriteBits(writer, 1, 2);
+        InputTraceWriteSigned(writer, quantized_value - InputTraceNearestStickStep(previous));
+    } else {
+        InputTraceWriteBits(writer, 3, 2);
+        InputTraceWriteBits(writer, InputTraceFloatBits(value), 32);
+    }
+}
+
+internal float32 InputTraceReadStick(InputTraceBitReader* reader, float32 previous) {
+    float32 result = previous;
+
+    if(InputTraceReadBits(reader, 1)) {
+        if(InputTraceReadBits(reader, 1) == 0) {
+            int32_t quantized_value = InputTraceNearestStickStep(previous) + InputTraceReadSigned(reader);
+            result = static_cast<float32>(quantized_value) / INPUT_TRACE_STICK_SCALE;
+        } else {
+            result = InputTraceBitsToFloat(InputTraceReadBits(reader, 32));
+        }
+    }
+
+    return result;
+}
+
+inline void InputTraceWriteMouseCoordinate(InputTraceBitWriter* writer, int32_t value, int32_t previous) {
+    // Note: Wrapping subtraction, so any pair of coordinates round-trips
+    InputTraceWriteUnsigned(writer, InputTraceZigZag(static_cast<int32_t>(
+        static_cast<uint32_t>(value) - static_cast<uint32_t>(previous))));
+}
+
+inline int32_t InputTraceReadMouseCoordinate(InputTraceBitReader* reader, int32_t previous) {
+    int32_t result = static_cast<int32_t>(
+        static_cast<uint32_t>(previous) + static_cast<uint32_t>(InputTraceReadSigned(reader)));
+
+    return result;
+}
+
+internal bool32 InputTraceIsControllerQuiet(GameControllerInput* controller, GameControllerInput* previous) {
+    if(controller->is_connected != previous->is_connected ||
+            controller->is_analog != previous->is_analog ||
+            InputTraceFloatBits(controller->stick_average_x) != InputTraceFloatBits(previous->stick_average_x) ||
+            InputTraceFloatBits(controller->stick_average_y) != InputTraceFloatBits(previous->stick_average_y)) {
+        return false;
+    }
+
+    for(int button_index = 0; button_index < NUM_SUPPORTED_CONTROLLER_BUTTONS; ++button_index) {
+        if(!InputTraceIsButtonQuiet(&controller->buttons[button_index], &previous->buttons[button_index])) {
+            return false;
+        }
+    }
+
+    return InputTraceIsButtonQuiet(&controller->terminator, &previous->terminator);
+}
+
+internal void InputTraceWriteController(
+        InputTraceBitWriter* writer, GameControllerInput* controller, GameControllerInput* previous) {
+    if(InputTraceIsControllerQuiet(controller, previous)) {
+        InputTraceWriteBits(writer, 0, 1);
+        return;
+    }
+
+    InputTraceWriteBits(writer, 1, 1);
+    InputTraceWriteBool32(writer, controller->is_connected, previous->is_connected);
+    InputTraceWriteBool32(writer, controller->is_analog, previous->is_analog);
+    InputTraceWriteStick(writer, controller->stick_average_x, previous->stick_average_x);
+    InputTraceWriteStick(writer, controller->stick_average_y, previous->stick_average_y);
+
+    for(int button_index = 0; button_index < NUM_SUPPORTED_CONTROLLER_BUTTONS; ++button_index) {
+        InputTraceWriteButton(writer, &controller->buttons[button_index], &previous->buttons[button_index]);
+    }
+
+    InputTraceWriteButton(writer, &controller->terminator, &previous->terminator);
+}
+
+internal void InputTraceReadController(
+        InputTraceBitReader* reader, GameControllerInput* controller, GameControllerInput* previous) {
+    *controller = *previous;
+
+    if(InputTraceReadBits(reader, 1) == 0) {
+        for(int button_index = 0; button_index < NUM_SUPPORTED_CONTROLLER_BUTTONS; ++button_index) {
+            controller->buttons[button_index].half_transition_count = 0;
+        }
+
+        controller->terminator.half_transition_count = 0;
+        return;
+    }
+
+    controller->is_connected = InputTraceReadBool32(reader, previous->is_connected);
+    controller->is_analog = InputTraceReadBool32(reader, previous->is_analog);
+    controller->stick_average_x = InputTraceReadStick(reader, previous->stick_average_x);
+    controller->stick_average_y = InputTraceReadStick(reader, previous->stick_average_y);
+
+    for(int button_index = 0; button_index < NUM_SUPPORTED_CONTROLLER_BUTTONS; ++button_index) {
+        InputTraceReadButton(reader, &controller->buttons[button_index], &previous->buttons[button_index]);
+    }
+
+    InputTraceReadButton(reader, &controller->terminator, &previous->terminator);
+}
+
+//
+// Encoder
+//
+
+internal void InputTraceBeginBlock(InputTraceEncoder* encoder) {
+    encoder->writer.size = 0;
+    encoder->writer.bit_buffer = 0;
+    encoder->writer.bit_count = 0;
+    encoder->previous = {};
+    encoder->first_frame_index += encoder->frame_count;
+    encoder->frame_count = 0;
+}
+
+// Note: payload_memory must hold at least INPUT_TRACE_MAX_BLOCK_PAYLOAD_SIZE bytes
+internal void InputTraceBeginEncoder(InputTraceEncoder* encoder, void* payload_memory, uint32_t payload_capacity) {
+    Assert(payload_capacity >= INPUT_TRACE_MAX_BLOCK_PAYLOAD_SIZE);
+
+    *encoder = {};
+    encoder->writer.base = static_cast<uint8_t*>(payload_memory);
+    encoder->writer.capacity = payload_capacity;
+}
+
+// Returns true once the current block is full and must be finished before the next frame is encoded
+internal bool32 InputTraceEncodeFrame(InputTraceEncoder* encoder, GameInput* input) {
+    Assert(encoder->frame_count < INPUT_TRACE_FRAMES_PER_BLOCK);
+
+    InputTraceBitWriter* writer = &encoder->writer;
+    GameInput* previous = &encoder->previous;
+
+    if(InputTraceFloatBits(input->delta_time_for_frame) == InputTraceFloatBits(previous->delta_time_for_frame)) {
+        InputTraceWriteBits(writer, 0, 1);
+    } else {
+        InputTraceWriteBits(writer, 1, 1);
+        InputTraceWriteBits(writer, InputTraceFloatBits(input->delta_time_for_frame), 32);
+    }
+
+    InputTraceWriteMouseCoordinate(writer, input->mouse_x, previous->mouse_x);
+    InputTraceWriteMouseCoordinate(writer, input->mouse_y, previous->mouse_y);
+    InputTraceWriteMouseCoordinate(writer, input->mouse_z, previous->mouse_z);
+
+    for(int button_index = 0; button_index < NUM_SUPPORTED_MOUSE_BUTTONS; ++button_index) {
+        InputTraceWriteButton(writer, &input->mouse_buttons[button_index], &previous->mouse_buttons[button_index]);
+    }
+
+    for(int controller_index = 0; controller_index < NUM_SUPPORTED_CONTROLLERS; ++controller_index) {
+        InputTraceWriteController(
+            writer, &input->controllers[controller_index], &previous->controllers[controller_index]);
+    }
+
+    *previous = *input;
+    ++encoder->frame_count;
+
+    bool32 result = encoder->frame_count == INPUT_TRACE_FRAMES_PER_BLOCK;
+
+    return result;
+}
+
+// Fills out the header for the frames encoded so far. The caller writes the header followed by
+// header->payload_size bytes of encoder->writer.base, then calls InputTraceBeginBlock.
+internal void InputTraceFinishBlock(InputTraceEncoder* encoder, InputTraceBlockHeader* header) {
+    InputTraceFlushBits(&encoder->writer);
+
+    header->magic = INPUT_TRACE_BLOCK_MAGIC;
+    header->first_frame_index = encoder->first_frame_index;
+    header->frame_count = encoder->frame_count;
+    header->payload_size = encoder->writer.size;
+    header->checksum = InputTraceChecksum(encoder->writer.base, encoder->writer.size);
+}
+
+//
+// Decoder
+//
+
+inline bool32 InputTraceIsFileHeaderValid(InputTraceFileHeader* header) {
+    bool32 result =
+        header->magic == INPUT_TRACE_FILE_MAGIC &&
+        header->version == INPUT_TRACE_VERSION &&
+        header->input_size == sizeof(GameInput);
+
+    return result;
+}
+
+inline bool32 InputTraceIsBlockHeaderValid(InputTraceBlockHeader* header) {
+    bool32 result =
+        header->magic == INPUT_TRACE_BLOCK_MAGIC &&
+        header->frame_count <= INPUT_TRACE_FRAMES_PER_BLOCK &&
+        header->payload_size <= INPUT_TRACE_MAX_BLOCK_PAYLOAD_SIZE;
+
+    return result;
+}
+
+// Returns false if the payload doesn't match the header, in which case nothing can be decoded from it
+internal bool32 InputTraceBeginDecodeBlock(InputTraceDecoder* decoder, InputTraceBlockHeader* header, void* payload) {
+    *decoder = {};
+
+    if(!InputTraceIsBlockHeaderValid(header) ||
+            InputTraceChecksum(static_cast<uint8_t*>(payload), header->payload_size) != header->checksum) {
+        return false;
+    }
+
+    decoder->reader.base = static_cast<uint8_t*>(payload);
+    decoder->reader.size = header->payload_size;
+    decoder->next_frame_index = header->first_frame_index;
+    decoder->frames_remaining = header->frame_count;
+
+    return true;
+}
+
+// Returns false when the block is exhausted (or turned out to be truncated)
+internal bool32 InputTraceDecodeFrame(InputTraceDecoder* decoder, GameInput* input) {
+    if(decoder->frames_remaining == 0) {
+        return false;
+    }
+
+    InputTraceBitReader* reader = &decoder->reader;
+    GameInput* previous = &decoder->previous;
+
+    input->delta_time_for_frame = previous->delta_time_for_frame;
+
+    if(InputTraceReadBits(reader, 1)) {
+        input->delta_time_for_frame = InputTraceBitsToFloat(InputTraceReadBits(reader, 32));
+    }
+
+    input->mouse_x = InputTraceReadMouseCoordinate(reader, previous->mouse_x);
+    input->mouse_y = InputTraceReadMouseCoordinate(reader, previous->mouse_y);
+    input->mouse_z = InputTraceReadMouseCoordinate(reader, previous->mouse_z);
+
+    for(int button_index = 0; button_index < NUM_SUPPORTED_MOUSE_BUTTONS; ++button_index) {
+        InputTraceReadButton(reader, &input->mouse_buttons[button_index], &previous->mouse_buttons[button_index]);
+    }
+
+    for(int controller_index = 0; controller_index < NUM_SUPPORTED_CONTROLLERS; ++controller_index) {
+        InputTraceReadController(
+            reader, &input->controllers[controller_index], &previous->controllers[controller_index]);
+    }
+
+    if(reader->is_overrun) {
+        decoder->frames_remaining = 0;
+        return false;
+    }
+
+    *previous = *input;
+    ++decoder->next_frame_index;
+    --decoder->frames_remaining;
+
+    return true;
+}
+
+#endif  // !WATCHER_INPUT_TRACE_H
@@ -0,0 +1,401 @@
+// Test for the packed input trace format in watcher_input_trace.h. Nothing in it is platform
+// specific, so it builds anywhere:
+//
+//     g++ -O2 -DNAMELESS_WATCHER_SLOW=1 watcher_input_trace_test.cpp -o watcher_input_trace_test
+//
+// A long stream of random frames is encoded into blocks the way the platform records a trace, and
+// every frame has to decode back to exactly the same bits. The frames are mostly the quiet, small
+// changes real input makes, mixed with everything the format has to escape: stick values off the
+// stick grid (and NaNs, negative zero, values past +-1), bool32s that aren't 0 or 1, and mouse
+// coordinates whose deltas wrap. The stream doesn't end on a block boundary, so the final block is a
+// partial one. Damaged and truncated blocks have to be rejected, and snapping stick values has to
+// settle after one step.
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "watcher_input_trace.h"
+
+// Note: Deliberately not a multiple of INPUT_TRACE_FRAMES_PER_BLOCK
+#define TEST_FRAME_COUNT (INPUT_TRACE_FRAMES_PER_BLOCK * 100 + 37)
+#define TEST_BLOCK_COUNT ((TEST_FRAME_COUNT + INPUT_TRACE_FRAMES_PER_BLOCK - 1) / INPUT_TRACE_FRAMES_PER_BLOCK)
+#define TEST_STICK_SAMPLE_COUNT 4000000
+
+struct TestBlock {
+    InputTraceBlockHeader header;
+    uint8_t* payload;
+};
+
+global_variable GameInput g_frames[TEST_FRAME_COUNT];
+global_variable TestBlock g_blocks[TEST_BLOCK_COUNT];
+global_variable uint8_t g_payloads[TEST_BLOCK_COUNT][INPUT_TRACE_MAX_BLOCK_PAYLOAD_SIZE];
+
+global_variable uint32_t g_random_state = 0x2545F491;
+
+internal uint32_t GetTestRandom() {
+    // Note: xorshift32, so the test runs the same everywhere
+    g_random_state ^= g_random_state << 13;
+    g_random_state ^= g_random_state >> 17;
+    g_random_state ^= g_random_state << 5;
+
+    return g_random_state;
+}
+
+// Note: True one time in every n
+inline bool32 TestChance(uint32_t n) {
+    bool32 result = GetTestRandom() % n == 0;
+
+    return result;
+}
+
+internal float32 GetTestStickValue(float32 previous) {
+    float32 result = previous;
+
+    switch(GetTestRandom() % 12) {
+        case 0: {
+            result = InputTraceBitsToFloat(GetTestRandom());
+        } break;
+
+        case 1: {
+            // Note: Anywhere in range, but not on the grid
+            result = static_cast<float32>(GetTestRandom() % 2000001) / 1000000.0f - 1.0f;
+        } break;
+
+        case 2: {
+            float32 specials[] = {-0.0f, 0.0f, 1.0f, -1.0f, 1.5f, -7.0f, NAN, INFINITY, 1e-30f};
+            result = specials[GetTestRandom() % (sizeof(specials) / sizeof(specials[0]))];
+        } break;
+
+        default: {
+            // Note: What the platform really hands over, small moves on the grid
+            int32_t step = InputTraceNearestStickStep(previous) + static_cast<int32_t>(GetTestRandom() % 801) - 400;
+
+            if(step > 32767) {
+                step = 32767;
+            } else if(step < -32767) {
+                step = -32767;
+            }
+
+            result = InputTraceSnapStick(static_cast<float32>(step) / INPUT_TRACE_STICK_SCALE);
+        } break;
+    }
+
+    return result;
+}
+
+internal bool32 GetTestBool32(bool32 previous) {
+    bool32 result = previous;
+
+    if(TestChance(8)) {
+        bool32 wild_values[] = {0, 1, 2, -1, static_cast<bool32>(0x80000000), 0x7FFFFFFF, 0x10};
+        result = wild_values[GetTestRandom() % (sizeof(wild_values) / sizeof(wild_values[0]))];
+    } else if(TestChance(4)) {
+        result = !previous;
+    }
+
+    return result;
+}
+
+internal void GetTestButton(GameButtonState* button, GameButtonState* previous) {
+    button->half_transition_count = 0;
+    button->ended_down = previous->ended_down;
+
+    if(TestChance(6)) {
+        button->half_transition_count = 1 + GetTestRandom() % 3;
+        button->ended_down = GetTestBool32(previous->ended_down);
+    } else if(TestChance(200)) {
+        button->half_transition_count = static_cast<int>(GetTestRandom());
+    }
+}
+
+internal int32_t GetTestMouseCoordinate(int32_t previous) {
+    int32_t result = previous;
+
+    if(TestChance(50)) {
+        // Note: Anything at all, so deltas wrap around in both directions
+        int32_t extremes[] = {INT32_MAX, INT32_MIN, INT32_MIN + 1, -1, 0};
+        result = TestChance(2)
+            ? extremes[GetTestRandom() % (sizeof(extremes) / sizeof(extremes[0]))]
+            : static_cast<int32_t>(GetTestRandom());
+    } else if(TestChance(3)) {
+        result = static_cast<int32_t>(static_cast<uint32_t>(previous) + GetTestRandom() % 41 - 20);
+    }
+
+    return result;
+}
+
+internal void GetTestFrame(GameInput* input, GameInput* previous) {
+    *input = *previous;
+
+    if(TestChance(30)) {
+        input->delta_time_for_frame = TestChance(2) ? 1.0f / 60.0f : InputTraceBitsToFloat(GetTestRandom());
+    }
+
+    input->mouse_x = GetTestMouseCoordinate(previous->mouse_x);
+    input->mouse_y = GetTestMouseCoordinate(previous->mouse_y);
+    input->mouse_z = GetTestMouseCoordinate(previous->mouse_z);
+
+    for(int button_index = 0; button_index < NUM_SUPPORTED_MOUSE_BUTTONS; ++button_index) {
+        GetTestButton(&input->mouse_buttons[button_index], &previous->mouse_buttons[button_index]);
+    }
+
+    for(int controller_index = 0; controller_index < NUM_SUPPORTED_CONTROLLERS; ++controller_index) {
+        GameControllerInput* controller = &input->controllers[controller_index];
+        GameControllerInput* previous_controller = &previous->controllers[controller_index];
+
+        for(int button_index = 0; button_index < NUM_SUPPORTED_CONTROLLER_BUTTONS; ++button_index) {
+            controller->buttons[button_index].half_transition_count = 0;
+        }
+
+        controller->terminator.half_transition_count = 0;
+
+        // Note: Most controllers do nothing most frames
+        if(TestChance(3)) {
+            continue;
+        }
+
+        controller->is_connected = GetTestBool32(previous_controller->is_connected);
+        controller->is_analog = GetTestBool32(previous_controller->is_analog);
+
+        if(TestChance(2)) {
+            controller->stick_average_x = GetTestStickValue(previous_controller->stick_average_x);
+            controller->stick_average_y = GetTestStickValue(previous_controller->stick_average_y);
+        }
+
+        for(int button_index = 0; button_index < NUM_SUPPORTED_CONTROLLER_BUTTONS; ++button_index) {
+            GetTestButton(&controller->buttons[button_index], &previous_controller->buttons[button_index]);
+        }
+
+        GetTestButton(&controller->terminator, &previous_controller->terminator);
+    }
+}
+
+// Note: Encodes g_frames into g_blocks, the same way the platform records
+internal void EncodeTestFrames() {
+    InputTraceEncoder encoder;
+    InputTraceBeginEncoder(&encoder, g_payloads[0], INPUT_TRACE_MAX_BLOCK_PAYLOAD_SIZE);
+
+    uint32_t block_index = 0;
+
+    for(uint32_t frame_index = 0; frame_index < TEST_FRAME_COUNT; ++frame_index) {
+        encoder.writer.base = g_payloads[block_index];
+
+        if(InputTraceEncodeFrame(&encoder, &g_frames[frame_index]) || frame_index == TEST_FRAME_COUNT - 1) {
+            g_blocks[block_index].payload = g_payloads[block_index];
+            InputTraceFinishBlock(&encoder, &g_blocks[block_index].header);
+            InputTraceBeginBlock(&encoder);
+            ++block_index;
+        }
+    }
+}
+
+// Note: Returns how many frames decoded to exactly what was encoded, stopping at the first that didn't
+internal uint32_t DecodeTestBlock(InputTraceBlockHeader* header, uint8_t* payload) {
+    InputTraceDecoder decoder;
+
+    if(!InputTraceBeginDecodeBlock(&decoder, header, payload)) {
+        return 0;
+    }
+
+    uint32_t result = 0;
+    GameInput input;
+
+    while(InputTraceDecodeFrame(&decoder, &input)) {
+        uint32_t frame_index = header->first_frame_index + result;
+
+        if(frame_index >= TEST_FRAME_COUNT || memcmp(&input, &g_frames[frame_index], sizeof(input)) != 0) {
+            break;
+        }
+
+        ++result;
+    }
+
+    return result;
+}
+
+internal bool32 RunRoundTripTest() {
+    bool32 result = true;
+
+    GameInput previous = {};
+    for(uint32_t frame_index = 0; frame_index < TEST_FRAME_COUNT; ++frame_index) {
+        GetTestFrame(&g_frames[frame_index], &previous);
+        previous = g_frames[frame_index];
+    }
+
+    EncodeTestFrames();
+
+    uint32_t decoded_frame_count = 0;
+    uint64_t payload_size = 0;
+
+    for(uint32_t block_index = 0; block_index < TEST_BLOCK_COUNT; ++block_index) {
+        TestBlock* block = &g_blocks[block_index];
+
+        uint32_t expected_frame_count = INPUT_TRACE_FRAMES_PER_BLOCK;
+        if(block_index == TEST_BLOCK_COUNT - 1) {
+            expected_frame_count = TEST_FRAME_COUNT - block_index * INPUT_TRACE_FRAMES_PER_BLOCK;
+        }
+
+        if(block->header.first_frame_index != decoded_frame_count ||
+                block->header.frame_count != expected_frame_count) {
+            printf("Block %u starts at frame %u with %u frames\n",
+                block_index, block->header.first_frame_index, block->header.frame_count);
+            result = false;
+            break;
+        }
+
+        uint32_t block_frame_count = DecodeTestBlock(&block->header, block->payload);
+
+        if(block_frame_count != block->header.frame_count) {
+            printf("Frame %u didn't decode to what was encoded\n", decoded_frame_count + block_frame_count);
+            result = false;
+            break;
+        }
+
+        decoded_frame_count += block_frame_count;
+        payload_size += block->header.payload_size;
+    }
+
+    if(result && decoded_frame_count != TEST_FRAME_COUNT) {
+        printf("Decoded %u of %u frames\n", decoded_frame_count, TEST_FRAME_COUNT);
+        result = false;
+    }
+
+    if(result) {
+        printf("%.1f bytes per frame, against %u raw\n",
+            static_cast<double>(payload_size) / TEST_FRAME_COUNT, static_cast<uint32_t>(sizeof(GameInput)));
+    }
+
+    return result;
+}
+
+// Note: Run after RunRoundTripTest, on the blocks it encoded
+internal bool32 RunDamagedBlockTest() {
+    bool32 result = true;
+
+    for(uint32_t block_index = 0; block_index < TEST_BLOCK_COUNT && result; ++block_index) {
+        TestBlock* block = &g_blocks[block_index];
+        InputTraceBlockHeader header = block->header;
+        InputTraceDecoder decoder;
+
+        // Note: Any flipped bit in the payload fails the checksum
+        uint32_t bit_index = GetTestRandom() % (header.payload_size * 8);
+        block->payload[bit_index / 8] ^= static_cast<uint8_t>(1 << (bit_index % 8));
+
+        if(InputTraceBeginDecodeBlock(&decoder, &header, block->payload)) {
+            printf("Block %u was accepted with bit %u flipped\n", block_index, bit_index);
+            result = false;
+        }
+
+        block->payload[bit_index / 8] ^= static_cast<uint8_t>(1 << (bit_index % 8));
+
+        // Note: So do a wrong checksum or payload size, and the header itself is checked too
+        InputTraceBlockHeader bad_headers[5] = {header, header, header, header, header};
+        bad_headers[0].checksum ^= 1;
+        bad_headers[1].payload_size -= 1;
+        bad_headers[2].magic = INPUT_TRACE_FILE_MAGIC;
+        bad_headers[3].frame_count = INPUT_TRACE_FRAMES_PER_BLOCK + 1;
+        bad_headers[4].payload_size = INPUT_TRACE_MAX_BLOCK_PAYLOAD_SIZE + 1;
+
+        for(int header_index = 0; header_index < 5; ++header_index) {
+            if(InputTraceBeginDecodeBlock(&decoder, &bad_headers[header_index], block->payload)) {
+                printf("Block %u was accepted with bad header %d\n", block_index, header_index);
+                result = false;
+            }
+        }
+
+        // Note: A block cut short whose checksum still matches, as if the file had been truncated and
+        // the header rewritten, has to stop early instead of making up the frames it lost
+        uint32_t truncated_size = GetTestRandom() % header.payload_size;
+        header.payload_size = truncated_size;
+        header.checksum = InputTraceChecksum(block->payload, truncated_size);
+
+        uint32_t truncated_frame_count = DecodeTestBlock(&header, block->payload);
+
+        if(truncated_frame_count >= header.frame_count) {
+            printf("Block %u cut to %u bytes still decoded every frame\n", block_index, truncated_size);
+            result = false;
+        }
+
+        // Note: And the block itself is still good
+        if(DecodeTestBlock(&block->header, block->payload) != block->header.frame_count) {
+            printf("Block %u no longer decodes\n", block_index);
+            result = false;
+        }
+    }
+
+    return result;
+}
+
+internal bool32 CheckSnappedStick(float32 value) {
+    float32 snapped_value = InputTraceSnapStick(value);
+    float32 resnapped_value = InputTraceSnapStick(snapped_value);
+
+    int32_t quantized_value;
+    bool32 result =
+        InputTraceFloatBits(resnapped_value) == InputTraceFloatBits(snapped_value) &&
+        InputTraceQuantizeStick(snapped_value, &quantized_value) &&
+        fabsf(snapped_value - value) <= 0.5f / INPUT_TRACE_STICK_SCALE + 1e-7f;
+
+    if(!result) {
+        printf("%.9g snapped to %.9g, then to %.9g\n", value, snapped_value, resnapped_value);
+    }
+
+    return result;
+}
+
+internal bool32 RunSnapStickTest() {
+    bool32 result = true;
+
+    // Note: Every point on the grid is already snapped
+    for(int32_t step = -32767; step <= 32767 && result; ++step) {
+        float32 value = static_cast<float32>(step) / INPUT_TRACE_STICK_SCALE;
+
+        int32_t quantized_value;
+        if(!CheckSnappedStick(value) ||
+                InputTraceFloatBits(InputTraceSnapStick(value)) != InputTraceFloatBits(value) ||
+                !InputTraceQuantizeStick(value, &quantized_value) || quantized_value != step) {
+            printf("Grid step %d doesn't stay put\n", step);
+            result = false;
+        }
+    }
+
+    float32 edge_values[] = {-1.0f, 1.0f, 0.0f, -0.0f, 1e-38f, -1e-38f, 0.5f / 32767.0f, -0.5f / 32767.0f};
+
+    for(uint32_t value_index = 0; value_index < sizeof(edge_values) / sizeof(edge_values[0]); ++value_index) {
+        result = CheckSnappedStick(edge_values[value_index]) && result;
+    }
+
+    // Note: Anything in range, including what XInput's deadzone scaling turns out
+    for(uint32_t sample_index = 0; sample_index < TEST_STICK_SAMPLE_COUNT && result; ++sample_index) {
+        float32 value = InputTraceBitsToFloat(GetTestRandom());
+
+        if(value >= -1.0f && value <= 1.0f) {
+            result = CheckSnappedStick(value);
+        } else {
+            // Note: Out of range, or NaN, is left exactly alone
+            if(InputTraceFloatBits(InputTraceSnapStick(value)) != InputTraceFloatBits(value)) {
+                printf("%.9g was snapped, but is out of range\n", value);
+                result = false;
+            }
+        }
+
+        float32 scaled_value = static_cast<float32>(static_cast<int32_t>(GetTestRandom() % 65535) - 32767) / 32767.0f;
+        result = CheckSnappedStick(scaled_value * 0.9999f) && result;
+    }
+
+    return result;
+}
+
+int main() {
+    bool32 round_trip_passed = RunRoundTripTest();
+    printf("Round trip, %u frames: %s\n", TEST_FRAME_COUNT, round_trip_passed ? "passed" : "FAILED");
+
+    bool32 damaged_passed = RunDamagedBlockTest();
+    printf("Damaged blocks, %u blocks: %s\n", TEST_BLOCK_COUNT, damaged_passed ? "passed" : "FAILED");
+
+    bool32 snap_passed = RunSnapStickTest();
+    printf("Stick snapping: %s\n", snap_passed ? "passed" : "FAILED");
+
+    return round_trip_passed && damaged_passed && snap_passed ? 0 : 1;
+}
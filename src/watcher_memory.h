@@ -0,0 +1,131 @@
+#ifndef WATCHER_MEMORY_H
+#define WATCHER_MEMORY_H
+
+// Linear arenas that carve up the storage blocks the platform hands the game.
+//
+// Every arena tracks how much of it is in use, the most that has ever been in use, and how deeply
+// temporary scopes are nested, so the game can report its real footprint back to the platform (see
+// ReportArena) instead of the platform only knowing the size it reserved.
+
+#include "watcher_platform.h"
+
+// Note: Every push starts on this boundary, which is enough for anything SSE loads or stores
+#define ARENA_DEFAULT_ALIGNMENT 16
+
+struct MemoryArena {
+    uint64_t size;
+    uint8_t* base;
+    uint64_t used;
+    uint64_t peak_used;
+
+    int32_t temp_count;
+    int32_t max_temp_count;
+};
+
+struct TemporaryMemory {
+    MemoryArena* arena;
+    uint64_t used;
+};
+
+inline void InitializeArena(MemoryArena* arena, uint64_t size, void* base) {
+    *arena = {};
+    arena->size = size;
+    arena->base = static_cast<uint8_t*>(base);
+}
+
+#define PushStruct(arena, type) static_cast<type*>(PushSize_(arena, sizeof(type)))
+#define PushArray(arena, count, type) static_cast<type*>(PushSize_(arena, (count) * sizeof(type)))
+#define PushSize(arena, size) PushSize_(arena, size)
+
+inline void* PushSize_(MemoryArena* arena, uint64_t size) {
+    uint64_t alignment_mask = ARENA_DEFAULT_ALIGNMENT - 1;
+    uint64_t aligned_used = (arena->used + alignment_mask) & ~alignment_mask;
+    Assert(aligned_used + size <= arena->size);
+
+    void* result = arena->base + aligned_used;
+    arena->used = aligned_used + size;
+
+    if(arena->used > arena->peak_used) {
+        arena->peak_used = arena->used;
+    }
+
+    return result;
+}
+
+// Note: Everything pushed between Begin and End is thrown away at End. Scopes may nest, but have to
+// end in the reverse order they began.
+inline TemporaryMemory BeginTemporaryMemory(MemoryArena* arena) {
+    TemporaryMemory result;
+    result.arena = arena;
+    result.used = arena->used;
+
+    ++arena->temp_count;
+    if(arena->temp_count > arena->max_temp_count) {
+        arena->max_temp_count = arena->temp_count;
+    }
+
+    return result;
+}
+
+inline void EndTemporaryMemory(TemporaryMemory temp_memory) {
+    MemoryArena* arena = temp_memory.arena;
+    Assert(arena->used >= temp_memory.used);
+    Assert(arena->temp_count > 0);
+
+    arena->used = temp_memory.used;
+    --arena->temp_count;
+}
+
+// Note: Call once a frame, when no temporary scope should still be open
+inline void CheckArena(MemoryArena* arena) {
+    Assert(arena->temp_count == 0);
+}
+
+inline bool32 ArenaNamesMatch(char* a, const char* b) {
+    int index = 0;
+
+    while(index < PLATFORM_ARENA_NAME_LENGTH - 1 && a[index] && a[index] == b[index]) {
+        ++index;
+    }
+
+    bool32 result = index == PLATFORM_ARENA_NAME_LENGTH - 1 || a[index] == b[index];
+
+    return result;
+}
+
+// Note: Copies the arena's numbers into the platform's stats under the given name, taking a new slot
+// the first time a name is seen. The name is copied too, since string literals in the game code go
+// away when it reloads.
+internal void ReportArena(PlatformMemoryStats* stats, const char* name, MemoryArena* arena) {
+    PlatformArenaStats* arena_stats = 0;
+
+    for(int32_t arena_index = 0; arena_index < stats->arena_count; ++arena_index) {
+        if(ArenaNamesMatch(stats->arenas[arena_index].name, name)) {
+            arena_stats = &stats->arenas[arena_index];
+            break;
+        }
+    }
+
+    if(!arena_stats) {
+        if(stats->arena_count >= PLATFORM_MAX_ARENA_STATS) {
+            return;
+        }
+
+        arena_stats = &stats->arenas[stats->arena_count++];
+
+        int index = 0;
+        for(; index < PLATFORM_ARENA_NAME_LENGTH - 1 && name[index]; ++index) {
+            arena_stats->name[index] = name[index];
+        }
+
+        arena_stats->name[index] = 0;
+    }
+
+    arena_stats->size = arena->size;
+    arena_stats->used = arena->used;
+    arena_stats->peak_used = arena->peak_used;
+    arena_stats->temp_count = arena->temp_count;
+    arena_stats->max_temp_count = arena->max_temp_count;
+}
+
+#endif  // !WATCHER_MEMORY_H
@@ -0,0 +1,329 @@
+#ifndef WATCHER_OVERLAY_H
+#define WATCHER_OVERLAY_H
+
+// In-game performance overlay: a frame time graph, FPS, per-thread utilization, memory use and the
+// code reload count, drawn over the top-left corner of the frame from the stats the platform hands the game.
+//
+// Note: The text is only rebuilt every OVERLAY_TEXT_REFRESH_FRAMES frames. That keeps the numbers
+// readable, and means most frames find every line already laid out in the cache.
+
+#include "watcher_platform.h"
+#include "watcher_text.h"
+
+#define OVERLAY_X 8
+#define OVERLAY_Y 8
+#define OVERLAY_PADDING 8
+#define OVERLAY_SPACING 4
+#define OVERLAY_LINE_HEIGHT (FONT_GLYPH_HEIGHT + OVERLAY_SPACING)
+
+#define OVERLAY_GRAPH_BAR_WIDTH 2
+#define OVERLAY_GRAPH_WIDTH (PLATFORM_FRAME_HISTORY_COUNT * OVERLAY_GRAPH_BAR_WIDTH)
+#define OVERLAY_GRAPH_HEIGHT 64
+#define OVERLAY_TARGET_SECONDS (1.0f / 60.0f)
+#define OVERLAY_GRAPH_MAX_SECONDS (2.0f * OVERLAY_TARGET_SECONDS)
+
+#define OVERLAY_THREAD_BAR_WIDTH 12
+#define OVERLAY_THREAD_BAR_SPACING 4
+#define OVERLAY_THREAD_BAR_HEIGHT 24
+
+#define OVERLAY_WIDTH 320  // Fits the graph, and the text at everyday values
+#define OVERLAY_HEIGHT (2 * OVERLAY_PADDING + 5 * OVERLAY_LINE_HEIGHT + OVERLAY_GRAPH_HEIGHT + \
+    OVERLAY_THREAD_BAR_HEIGHT + 2 * OVERLAY_SPACING)
+
+#define OVERLAY_TEXT_REFRESH_FRAMES 15
+#define OVERLAY_AVERAGE_FRAMES 60
+
+#define OVERLAY_TEXT_COLOR 0x00FFFFFF
+#define OVERLAY_GOOD_COLOR 0x0040D060
+#define OVERLAY_SLOW_COLOR 0x00E0C030
+#define OVERLAY_BAD_COLOR 0x00E04040
+#define OVERLAY_GUIDE_COLOR 0x00808080
+#define OVERLAY_THREAD_IDLE_COLOR 0x00303030
+#define OVERLAY_THREAD_BUSY_COLOR 0x004090F0
+
+enum OverlayLine {
+    OverlayLine_Fps,
+    OverlayLine_WorstFrame,
+    OverlayLine_Threads,
+    OverlayLine_Memory,
+    OverlayLine_Reloads,
+
+    OverlayLine_Count,
+};
+
+struct OverlayState {
+    bool32 is_initialized;
+
+    bool32 has_text;
+    uint64_t text_frame_count;
+    uint32_t fps_color;
+    TextLine lines[OverlayLine_Count];
+
+    FontAtlas font;
+    TextLayoutCache layouts;
+};
+
+inline bool32 ClipRectangle(GameOffscreenBuffer* buffer, int* min_x, int* min_y, int* max_x, int* max_y) {
+    if(*min_x < 0) {
+        *min_x = 0;
+    }
+
+    if(*min_y < 0) {
+        *min_y = 0;
+    }
+
+    if(*max_x > buffer->width) {
+        *max_x = buffer->width;
+    }
+
+    if(*max_y > buffer->height) {
+        *max_y = buffer->height;
+    }
+
+    bool32 result = *min_x < *max_x && *min_y < *max_y;
+
+    return result;
+}
+
+internal void FillRectangle(GameOffscreenBuffer* buffer, int min_x, int min_y, int max_x, int max_y, uint32_t color) {
+    if(!ClipRectangle(buffer, &min_x, &min_y, &max_x, &max_y)) {
+        return;
+    }
+
+    __m128i color_4x = _mm_set1_epi32(static_cast<int>(color));
+    uint8_t* row = static_cast<uint8_t*>(buffer->memory) + min_y * buffer->pitch;
+
+    for(int y = min_y; y < max_y; ++y) {
+        uint32_t* pixel = reinterpret_cast<uint32_t*>(row) + min_x;
+        int x = min_x;
+
+        for(; x + 4 <= max_x; x += 4) {
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(pixel), color_4x);
+            pixel += 4;
+        }
+
+        for(; x < max_x; ++x) {
+            *pixel++ = color;
+        }
+
+        row += buffer->pitch;
+    }
+}
+
+// Note: Drops the rectangle to a quarter of its brightness, so text over it reads on any background
+internal void DarkenRectangle(GameOffscreenBuffer* buffer, int min_x, int min_y, int max_x, int max_y) {
+    if(!ClipRectangle(buffer, &min_x, &min_y, &max_x, &max_y)) {
+        return;
+    }
+
+    __m128i mask = _mm_set1_epi32(0x3F3F3F3F);
+    uint8_t* row = static_cast<uint8_t*>(buffer->memory) + min_y * buffer->pitch;
+
+    for(int y = min_y; y < max_y; ++y) {
+        uint32_t* pixel = reinterpret_cast<uint32_t*>(row) + min_x;
+        int x = min_x;
+
+        for(; x + 4 <= max_x; x += 4) {
+            __m128i* dest = reinterpret_cast<__m128i*>(pixel);
+            _mm_storeu_si128(dest, _mm_and_si128(_mm_srli_epi32(_mm_loadu_si128(dest), 2), mask));
+            pixel += 4;
+        }
+
+        for(; x < max_x; ++x) {
+            *pixel = (*pixel >> 2) & 0x3F3F3F3F;
+            ++pixel;
+        }
+
+        row += buffer->pitch;
+    }
+}
+
+inline uint32_t GetFrameTimeColor(float32 seconds) {
+    uint32_t result = OVERLAY_BAD_COLOR;
+
+    if(seconds <= 1.1f * OVERLAY_TARGET_SECONDS) {
+        result = OVERLAY_GOOD_COLOR;
+    } else if(seconds <= 2.0f * OVERLAY_TARGET_SECONDS) {
+        result = OVERLAY_SLOW_COLOR;
+    }
+
+    return result;
+}
+
+inline float32 GetFrameSeconds(PlatformFrameStats* stats, uint64_t frame_index) {
+    float32 result = stats->frame_seconds[frame_index % PLATFORM_FRAME_HISTORY_COUNT];
+
+    return result;
+}
+
+internal void BuildOverlayText(
+        OverlayState* overlay, PlatformFrameStats* stats, PlatformMemoryStats* memory_stats) {
+    uint64_t frame_count = stats->frame_count;
+    uint64_t sample_count = frame_count < OVERLAY_AVERAGE_FRAMES ? frame_count : OVERLAY_AVERAGE_FRAMES;
+
+    float32 total_seconds = 0.0f;
+    float32 worst_seconds = 0.0f;
+
+    for(uint64_t frame_index = frame_count - sample_count; frame_index < frame_count; ++frame_index) {
+        float32 seconds = GetFrameSeconds(stats, frame_index);
+        total_seconds += seconds;
+
+        if(seconds > worst_seconds) {
+            worst_seconds = seconds;
+        }
+    }
+
+    float32 average_seconds = sample_count ? total_seconds / static_cast<float32>(sample_count) : 0.0f;
+
+    TextLine* fps = &overlay->lines[OverlayLine_Fps];
+    fps->length = 0;
+    AppendFixed(fps, average_seconds > 0.0f ? 1.0f / average_seconds : 0.0f, 1);
+    AppendText(fps, " FPS, ");
+    AppendFixed(fps, 1000.0f * average_seconds, 2);
+    AppendText(fps, " ms");
+    overlay->fps_color = GetFrameTimeColor(average_seconds);
+
+    TextLine* worst_frame = &overlay->lines[OverlayLine_WorstFrame];
+    worst_frame->length = 0;
+    AppendText(worst_frame, "Worst ");
+    AppendFixed(worst_frame, 1000.0f * worst_seconds, 2);
+    AppendText(worst_frame, " ms");
+
+    float32 total_utilization = 0.0f;
+    for(int32_t thread_index = 0; thread_index < stats->thread_count; ++thread_index) {
+        total_utilization += stats->thread_utilization[thread_index];
+    }
+
+    TextLine* threads = &overlay->lines[OverlayLine_Threads];
+    threads->length = 0;
+    AppendUnsigned(threads, static_cast<uint32_t>(stats->thread_count));
+    AppendText(threads, stats->thread_count == 1 ? " thread, " : " threads, ");
+    float32 average_utilization =
+        stats->thread_count ? total_utilization / static_cast<float32>(stats->thread_count) : 0.0f;
+    AppendFixed(threads, 100.0f * average_utilization, 0);
+    AppendText(threads, "% busy");
+
+    TextLine* memory = &overlay->lines[OverlayLine_Memory];
+    memory->length = 0;
+    float32 resident_megabytes =
+        static_cast<float32>(memory_stats->resident_bytes) / static_cast<float32>(Megabytes(1));
+    AppendFixed(memory, resident_megabytes, 1);
+    AppendText(memory, " MB resident, ");
+    AppendUnsigned(memory, memory_stats->frame_page_fault_count);
+    AppendText(memory, memory_stats->frame_page_fault_count == 1 ? " fault" : " faults");
+
+    TextLine* reloads = &overlay->lines[OverlayLine_Reloads];
+    reloads->length = 0;
+    AppendText(reloads, "Code reloads: ");
+    AppendUnsigned(reloads, stats->code_reload_count);
+
+    overlay->has_text = true;
+    overlay->text_frame_count = frame_count;
+}
+
+internal void DrawFrameTimeGraph(GameOffscreenBuffer* buffer, PlatformFrameStats* stats, int x, int y) {
+    int bottom = y + OVERLAY_GRAPH_HEIGHT;
+
+    // Note: Oldest frame on the left, so the graph scrolls left as frames come in
+    uint64_t frame_count = stats->frame_count;
+    int first_bar = frame_count < PLATFORM_FRAME_HISTORY_COUNT ?
+        static_cast<int>(PLATFORM_FRAME_HISTORY_COUNT - frame_count) : 0;
+
+    for(int bar = first_bar; bar < PLATFORM_FRAME_HISTORY_COUNT; ++bar) {
+        float32 seconds = GetFrameSeconds(stats, frame_count - PLATFORM_FRAME_HISTORY_COUNT + bar);
+
+        float32 fraction = seconds / OVERLAY_GRAPH_MAX_SECONDS;
+        if(fraction > 1.0f) {
+            fraction = 1.0f;
+        }
+
+        int height = static_cast<int>(fraction * OVERLAY_GRAPH_HEIGHT + 0.5f);
+        int bar_x = x + bar * OVERLAY_GRAPH_BAR_WIDTH;
+
+        FillRectangle(
+            buffer, bar_x, bottom - height, bar_x + OVERLAY_GRAPH_BAR_WIDTH, bottom, GetFrameTimeColor(seconds));
+    }
+
+    int target_y = bottom - static_cast<int>(
+        OVERLAY_GRAPH_HEIGHT * OVERLAY_TARGET_SECONDS / OVERLAY_GRAPH_MAX_SECONDS + 0.5f);
+    FillRectangle(buffer, x, target_y, x + OVERLAY_GRAPH_WIDTH, target_y + 1, OVERLAY_GUIDE_COLOR);
+}
+
+internal void DrawThreadUtilization(GameOffscreenBuffer* buffer, PlatformFrameStats* stats, int x, int y) {
+    int bottom = y + OVERLAY_THREAD_BAR_HEIGHT;
+
+    int32_t thread_count = stats->thread_count;
+    if(thread_count > PLATFORM_MAX_REPORTED_THREADS) {
+        thread_count = PLATFORM_MAX_REPORTED_THREADS;
+    }
+
+    for(int32_t thread_index = 0; thread_index < thread_count; ++thread_index) {
+        float32 utilization = stats->thread_utilization[thread_index];
+
+        if(utilization < 0.0f) {
+            utilization = 0.0f;
+        } else if(utilization > 1.0f) {
+            utilization = 1.0f;
+        }
+
+        int height = static_cast<int>(utilization * OVERLAY_THREAD_BAR_HEIGHT + 0.5f);
+        int bar_x = x + thread_index * (OVERLAY_THREAD_BAR_WIDTH + OVERLAY_THREAD_BAR_SPACING);
+
+        FillRectangle(
+            buffer, bar_x, y, bar_x + OVERLAY_THREAD_BAR_WIDTH, bottom - height, OVERLAY_THREAD_IDLE_COLOR);
+        FillRectangle(
+            buffer, bar_x, bottom - height, bar_x + OVERLAY_THREAD_BAR_WIDTH, bottom, OVERLAY_THREAD_BUSY_COLOR);
+    }
+}
+
+internal void DrawPerformanceOverlay(
+        OverlayState* overlay, PlatformFrameStats* stats, PlatformMemoryStats* memory_stats,
+        GameOffscreenBuffer* buffer) {
+    if(!overlay->is_initialized) {
+        BuildFontAtlas(&overlay->font);
+        overlay->is_initialized = true;
+    }
+
+    if(!overlay->has_text || stats->frame_count - overlay->text_frame_count >= OVERLAY_TEXT_REFRESH_FRAMES ||
+            stats->frame_count < overlay->text_frame_count) {
+        BuildOverlayText(overlay, stats, memory_stats);
+    }
+
+    DarkenRectangle(buffer, OVERLAY_X, OVERLAY_Y, OVERLAY_X + OVERLAY_WIDTH, OVERLAY_Y + OVERLAY_HEIGHT);
+
+    int x = OVERLAY_X + OVERLAY_PADDING;
+    int y = OVERLAY_Y + OVERLAY_PADDING;
+
+    DrawText(
+        buffer, &overlay->layouts, &overlay->font, x, y, &overlay->lines[OverlayLine_Fps], overlay->fps_color);
+    y += OVERLAY_LINE_HEIGHT;
+
+    DrawText(
+        buffer, &overlay->layouts, &overlay->font, x, y, &overlay->lines[OverlayLine_WorstFrame],
+        OVERLAY_TEXT_COLOR);
+    y += OVERLAY_LINE_HEIGHT;
+
+    DrawFrameTimeGraph(buffer, stats, x, y);
+    y += OVERLAY_GRAPH_HEIGHT + OVERLAY_SPACING;
+
+    DrawText(
+        buffer, &overlay->layouts, &overlay->font, x, y, &overlay->lines[OverlayLine_Threads], OVERLAY_TEXT_COLOR);
+    y += OVERLAY_LINE_HEIGHT;
+
+    DrawThreadUtilization(buffer, stats, x, y);
+    y += OVERLAY_THREAD_BAR_HEIGHT + OVERLAY_SPACING;
+
+    DrawText(
+        buffer, &overlay->layouts, &overlay->font, x, y, &overlay->lines[OverlayLine_Memory], OVERLAY_TEXT_COLOR);
+    y += OVERLAY_LINE_HEIGHT;
+
+    DrawText(
+        buffer, &overlay->layouts, &overlay->font, x, y, &overlay->lines[OverlayLine_Reloads], OVERLAY_TEXT_COLOR);
+}
+
+// Note: The game exports DrawPerformanceOverlay as this, so the platform's benchmark times the same
+// code the game runs, built the same way
+typedef void GameDrawPerformanceOverlayFunc(
+    OverlayState* overlay, PlatformFrameStats* stats, PlatformMemoryStats* memory_stats, GameOffscreenBuffer* buffer);
+
+#endif  // !WATCHER_OVERLAY_H
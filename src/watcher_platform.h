@@ -7,6 +7,10 @@
 #define local_persist static
 #define global_variable static
 
+#define Kilobytes(value) ((value) * 1024LL)
+#define Megabytes(value) (Kilobytes(value) * 1024LL)
+#define Gigabytes(value) (Megabytes(value) * 1024LL)
+
 typedef int32_t bool32;
 typedef float float32;
 
@@ -78,7 +82,104 @@ struct GameInput {
     GameControllerInput controllers[NUM_SUPPORTED_CONTROLLERS];
 };
 
-typedef void GameUpdateAndRenderFunc(GameInput* input, GameOffscreenBuffer* buffer);
+// Note: Work queues are owned by the platform. Callbacks run on worker threads (or on whichever
+// thread is waiting), so anything they touch has to be safe to share.
+struct PlatformWorkQueue;
+
+typedef void PlatformWorkQueueCallback(PlatformWorkQueue* queue, void* data);
+typedef void PlatformParallelForCallback(void* data, int32_t first_index, int32_t one_past_last_index);
+
+// Note: Can be called from the main thread, or from within a callback
+typedef void PlatformAddWorkFunc(PlatformWorkQueue* queue, PlatformWorkQueueCallback* callback, void* data);
+
+// Note: Main thread only, runs queued work itself until everything added so far has finished
+typedef void PlatformCompleteAllWorkFunc(PlatformWorkQueue* queue);
+
+// Note: Splits [0, count) into batches of batch_size and returns once every batch has run. The caller
+// works on batches too, so this is safe to call from within a callback.
+typedef void PlatformParallelForFunc(
+    PlatformWorkQueue* queue, int32_t count, int32_t batch_size, PlatformParallelForCallback* callback, void* data);
+
+struct PlatformApi {
+    PlatformWorkQueue* work_queue;
+
+    PlatformAddWorkFunc* add_work;
+    PlatformCompleteAllWorkFunc* complete_all_work;
+    PlatformParallelForFunc* parallel_for;
+};
+
+#define PLATFORM_FRAME_HISTORY_COUNT 128
+#define PLATFORM_MAX_REPORTED_THREADS 16
+
+struct PlatformFrameStats {
+    // Note: Wall time of each whole frame, as a ring. The most recent frame is at
+    // (frame_count - 1) % PLATFORM_FRAME_HISTORY_COUNT.
+    float32 frame_seconds[PLATFORM_FRAME_HISTORY_COUNT];
+    uint64_t frame_count;
+
+    // Note: Fraction of the last frame each thread spent busy. Thread 0 is the main thread (time in
+    // the game's update), the rest are work queue workers (time running work).
+    int32_t thread_count;
+    float32 thread_utilization[PLATFORM_MAX_REPORTED_THREADS];
+
+    uint32_t code_reload_count;
+};
+
+#define PLATFORM_MAX_ARENA_STATS 16
+#define PLATFORM_ARENA_NAME_LENGTH 32
+
+struct PlatformArenaStats {
+    char name[PLATFORM_ARENA_NAME_LENGTH];
+    uint64_t size;
+    uint64_t used;
+    uint64_t peak_used;
+    int32_t temp_count;
+    int32_t max_temp_count;
+};
+
+struct PlatformMemoryStats {
+    // Note: Whole-process numbers, sampled by the platform at the end of every frame
+    uint64_t resident_bytes;
+    uint64_t peak_resident_bytes;
+    uint64_t committed_bytes;
+    uint64_t page_fault_count;  // Since startup
+    uint32_t frame_page_fault_count;
+    uint32_t peak_frame_page_fault_count;
+
+    // Note: One entry per page of permanent storage, counting how many write intervals (checkpoints,
+    // plus the stretch before exit) wrote to that page, saturating at 0xFFFF. Zero means the page has
+    // never been touched. Owned by the platform, and null if the platform couldn't track writes.
+    uint32_t page_size;
+    uint64_t page_count;
+    uint64_t touched_page_count;
+    uint32_t write_interval_count;
+    uint16_t* page_write_counts;
+
+    // Note: Filled in by the game, see ReportArena
+    int32_t arena_count;
+    PlatformArenaStats arenas[PLATFORM_MAX_ARENA_STATS];
+};
+
+struct GameMemory {
+    // Note: Lives in the platform layer, so these stay valid across game code reloads
+    PlatformApi platform;
+
+    // Note: Refreshed by the platform before every update
+    PlatformFrameStats frame_stats;
+    PlatformMemoryStats memory_stats;
+
+    // Note: Cleared to zero by the platform at startup. May be snapshotted and restored behind the
+    // game's back, so it must not contain pointers to anything outside of itself.
+    uint64_t permanent_storage_size;
+    void* permanent_storage;
+
+    // Note: Cleared to zero by the platform at startup, and never snapshotted or restored, so it's
+    // only for things the game can rebuild at any time (caches and the like)
+    uint64_t transient_storage_size;
+    void* transient_storage;
+};
+
+typedef void GameUpdateAndRenderFunc(GameMemory* memory, GameInput* input, GameOffscreenBuffer* buffer);
 typedef void GameGetSoundSamplesFunc();
 
 inline GameControllerInput* GetController(GameInput* input, int unsigned controller_index) {
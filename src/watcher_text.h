@@ -0,0 +1,461 @@
+#ifndef WATCHER_TEXT_H
+#define WATCHER_TEXT_H
+
+// Bitmap font text rendering straight into a GameOffscreenBuffer.
+//
+// The embedded 8x8 font is rasterized once, at startup, into a tightly packed coverage atlas: each
+// glyph is scaled up, trimmed to its inked columns (which makes the font proportional) and
+// shelf-packed. Drawing a line of text lays it out and composes its glyphs into a coverage strip,
+// which is cached keyed by a hash of the line's contents, so a line that hasn't changed since the last
+// frame costs one pass of its strip over the buffer and nothing else. Both the glyph copies and that
+// pass work 16 pixels at a time with SSE2.
+//
+// Note: Coverage bytes are only ever 0 or 255 (the font has no anti-aliasing), which lets drawing be a
+// masked select instead of a blend.
+
+#include <emmintrin.h>
+
+#include "watcher_platform.h"
+
+#define FONT_FIRST_CHARACTER ' '
+#define FONT_CHARACTER_COUNT 95  // Printable ASCII, ' ' through '~'
+#define FONT_SOURCE_SIZE 8
+#define FONT_SCALE 2
+
+#define FONT_GLYPH_HEIGHT (FONT_SOURCE_SIZE * FONT_SCALE)
+#define FONT_GLYPH_SPACING FONT_SCALE
+#define FONT_SPACE_ADVANCE (4 * FONT_SCALE)
+
+// Note: Glyphs are at most 16 pixels wide, so one 16-byte load covers any glyph row
+#define FONT_ATLAS_WIDTH 512
+#define FONT_ATLAS_STRIDE (FONT_ATLAS_WIDTH + 16)  // Room for a full 16-byte load at the last glyph
+#define FONT_ATLAS_HEIGHT (4 * FONT_GLYPH_HEIGHT)
+
+#define TEXT_MAX_LINE_LENGTH 64
+#define TEXT_MAX_LINE_WIDTH 512
+#define TEXT_LINE_STRIDE (TEXT_MAX_LINE_WIDTH + 16)  // Room for a full 16-byte store at the last glyph
+
+// Note: Must be a power of two
+#define TEXT_LAYOUT_CACHE_SIZE 32
+#define TEXT_LAYOUT_CACHE_PROBE_COUNT 4
+
+// Note: Based on the public domain font8x8 glyphs (from the IBM PC BIOS font). One byte per row, top
+// row first, and the lowest bit is the leftmost pixel.
+global_variable uint8_t g_font_8x8[FONT_CHARACTER_COUNT][FONT_SOURCE_SIZE] = {
+    { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 },  // ' '
+    { 0x18, 0x3C, 0x3C, 0x18, 0x18, 0x00, 0x18, 0x00 },  // '!'
+    { 0x36, 0x36, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 },  // '"'
+    { 0x36, 0x36, 0x7F, 0x36, 0x7F, 0x36, 0x36, 0x00 },  // '#'
+    { 0x0C, 0x3E, 0x03, 0x1E, 0x30, 0x1F, 0x0C, 0x00 },  // '$'
+    { 0x00, 0x63, 0x33, 0x18, 0x0C, 0x66, 0x63, 0x00 },  // '%'
+    { 0x1C, 0x36, 0x1C, 0x6E, 0x3B, 0x33, 0x6E, 0x00 },  // '&'
+    { 0x06, 0x06, 0x03, 0x00, 0x00, 0x00, 0x00, 0x00 },  // '''
+    { 0x18, 0x0C, 0x06, 0x06, 0x06, 0x0C, 0x18, 0x00 },  // '('
+    { 0x06, 0x0C, 0x18, 0x18, 0x18, 0x0C, 0x06, 0x00 },  // ')'
+    { 0x00, 0x66, 0x3C, 0xFF, 0x3C, 0x66, 0x00, 0x00 },  // '*'
+    { 0x00, 0x0C, 0x0C, 0x3F, 0x0C, 0x0C, 0x00, 0x00 },  // '+'
+    { 0x00, 0x00, 0x00, 0x00, 0x00, 0x0C, 0x0C, 0x06 },  // ','
+    { 0x00, 0x00, 0x00, 0x3F, 0x00, 0x00, 0x00, 0x00 },  // '-'
+    { 0x00, 0x00, 0x00, 0x00, 0x00, 0x0C, 0x0C, 0x00 },  // '.'
+    { 0x60, 0x30, 0x18, 0x0C, 0x06, 0x03, 0x01, 0x00 },  // '/'
+    { 0x3E, 0x63, 0x73, 0x7B, 0x6F, 0x67, 0x3E, 0x00 },  // '0'
+    { 0x0C, 0x0E, 0x0C, 0x0C, 0x0C, 0x0C, 0x3F, 0x00 },  // '1'
+    { 0x1E, 0x33, 0x30, 0x1C, 0x06, 0x33, 0x3F, 0x00 },  // '2'
+    { 0x1E, 0x33, 0x30, 0x1C, 0x30, 0x33, 0x1E, 0x00 },  // '3'
+    { 0x38, 0x3C, 0x36, 0x33, 0x7F, 0x30, 0x78, 0x00 },  // '4'
+    { 0x3F, 0x03, 0x1F, 0x30, 0x30, 0x33, 0x1E, 0x00 },  // '5'
+    { 0x1C, 0x06, 0x03, 0x1F, 0x33, 0x33, 0x1E, 0x00 },  // '6'
+    { 0x3F, 0x33, 0x30, 0x18, 0x0C, 0x0C, 0x0C, 0x00 },  // '7'
+    { 0x1E, 0x33, 0x33, 0x1E, 0x33, 0x33, 0x1E, 0x00 },  // '8'
+    { 0x1E, 0x33, 0x33, 0x3E, 0x30, 0x18, 0x0E, 0x00 },  // '9'
+    { 0x00, 0x0C, 0x0C, 0x00, 0x00, 0x0C, 0x0C, 0x00 },  // ':'
+    { 0x00, 0x0C, 0x0C, 0x00, 0x00, 0x0C, 0x0C, 0x06 },  // ';'
+    { 0x18, 0x0C, 0x06, 0x03, 0x06, 0x0C, 0x18, 0x00 },  // '<'
+    { 0x00, 0x00, 0x3F, 0x00, 0x00, 0x3F, 0x00, 0x00 },  // '='
+    { 0x06, 0x0C, 0x18, 0x30, 0x18, 0x0C, 0x06, 0x00 },  // '>'
+    { 0x1E, 0x33, 0x30, 0x18, 0x0C, 0x00, 0x0C, 0x00 },  // '?'
+    { 0x3E, 0x63, 0x7B, 0x7B, 0x7B, 0x03, 0x1E, 0x00 },  // '@'
+    { 0x0C, 0x1E, 0x33, 0x33, 0x3F, 0x33, 0x33, 0x00 },  // 'A'
+    { 0x3F, 0x66, 0x66, 0x3E, 0x66, 0x66, 0x3F, 0x00 },  // 'B'
+    { 0x3C, 0x66, 0x03, 0x03, 0x03, 0x66, 0x3C, 0x00 },  // 'C'
+    { 0x1F, 0x36, 0x66, 0x66, 0x66, 0x36, 0x1F, 0x00 },  // 'D'
+    { 0x7F, 0x46, 0x16, 0x1E, 0x16, 0x46, 0x7F, 0x00 },  // 'E'
+    { 0x7F, 0x46, 0x16, 0x1E, 0x16, 0x06, 0x0F, 0x00 },  // 'F'
+    { 0x3C, 0x66, 0x03, 0x03, 0x73, 0x66, 0x7C, 0x00 },  // 'G'
+    { 0x33, 0x33, 0x33, 0x3F, 0x33, 0x33, 0x33, 0x00 },  // 'H'
+    { 0x1E, 0x0C, 0x0C, 0x0C, 0x0C, 0x0C, 0x1E, 0x00 },  // 'I'
+    { 0x78, 0x30, 0x30, 0x30, 0x33, 0x33, 0x1E, 0x00 },  // 'J'
+    { 0x67, 0x66, 0x36, 0x1E, 0x36, 0x66, 0x67, 0x00 },  // 'K'
+    { 0x0F, 0x06, 0x06, 0x06, 0x46, 0x66, 0x7F, 0x00 },  // 'L'
+    { 0x63, 0x77, 0x7F, 0x7F, 0x6B, 0x63, 0x63, 0x00 },  // 'M'
+    { 0x63, 0x67, 0x6F, 0x7B, 0x73, 0x63, 0x63, 0x00 },  // 'N'
+    { 0x1C, 0x36, 0x63, 0x63, 0x63, 0x36, 0x1C, 0x00 },  // 'O'
+    { 0x3F, 0x66, 0x66, 0x3E, 0x06, 0x06, 0x0F, 0x00 },  // 'P'
+    { 0x1E, 0x33, 0x33, 0x33, 0x3B, 0x1E, 0x38, 0x00 },  // 'Q'
+    { 0x3F, 0x66, 0x66, 0x3E, 0x36, 0x66, 0x67, 0x00 },  // 'R'
+    { 0x1E, 0x33, 0x07, 0x0E, 0x38, 0x33, 0x1E, 0x00 },  // 'S'
+    { 0x3F, 0x2D, 0x0C, 0x0C, 0x0C, 0x0C, 0x1E, 0x00 },  // 'T'
+    { 0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0x3F, 0x00 },  // 'U'
+    { 0x33, 0x33, 0x33, 0x33, 0x33, 0x1E, 0x0C, 0x00 },  // 'V'
+    { 0x63, 0x63, 0x63, 0x6B, 0x7F, 0x77, 0x63, 0x00 },  // 'W'
+    { 0x63, 0x63, 0x36, 0x1C, 0x1C, 0x36, 0x63, 0x00 },  // 'X'
+    { 0x33, 0x33, 0x33, 0x1E, 0x0C, 0x0C, 0x1E, 0x00 },  // 'Y'
+    { 0x7F, 0x63, 0x31, 0x18, 0x4C, 0x66, 0x7F, 0x00 },  // 'Z'
+    { 0x1E, 0x06, 0x06, 0x06, 0x06, 0x06, 0x1E, 0x00 },  // '['
+    { 0x03, 0x06, 0x0C, 0x18, 0x30, 0x60, 0x40, 0x00 },  // '\'
+    { 0x1E, 0x18, 0x18, 0x18, 0x18, 0x18, 0x1E, 0x00 },  // ']'
+    { 0x08, 0x1C, 0x36, 0x63, 0x00, 0x00, 0x00, 0x00 },  // '^'
+    { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xFF },  // '_'
+    { 0x0C, 0x0C, 0x18, 0x00, 0x00, 0x00, 0x00, 0x00 },  // '`'
+    { 0x00, 0x00, 0x1E, 0x30, 0x3E, 0x33, 0x6E, 0x00 },  // 'a'
+    { 0x07, 0x06, 0x06, 0x3E, 0x66, 0x66, 0x3B, 0x00 },  // 'b'
+    { 0x00, 0x00, 0x1E, 0x33, 0x03, 0x33, 0x1E, 0x00 },  // 'c'
+    { 0x38, 0x30, 0x30, 0x3E, 0x33, 0x33, 0x6E, 0x00 },  // 'd'
+    { 0x00, 0x00, 0x1E, 0x33, 0x3F, 0x03, 0x1E, 0x00 },  // 'e'
+    { 0x1C, 0x36, 0x06, 0x0F, 0x06, 0x06, 0x0F, 0x00 },  // 'f'
+    { 0x00, 0x00, 0x6E, 0x33, 0x33, 0x3E, 0x30, 0x1F },  // 'g'
+    { 0x07, 0x06, 0x36, 0x6E, 0x66, 0x66, 0x67, 0x00 },  // 'h'
+    { 0x0C, 0x00, 0x0E, 0x0C, 0x0C, 0x0C, 0x1E, 0x00 },  // 'i'
+    { 0x30, 0x00, 0x30, 0x30, 0x30, 0x33, 0x33, 0x1E },  // 'j'
+    { 0x07, 0x06, 0x66, 0x36, 0x1E, 0x36, 0x67, 0x00 },  // 'k'
+    { 0x0E, 0x0C, 0x0C, 0x0C, 0x0C, 0x0C, 0x1E, 0x00 },  // 'l'
+    { 0x00, 0x00, 0x33, 0x7F, 0x7F, 0x6B, 0x63, 0x00 },  // 'm'
+    { 0x00, 0x00, 0x1F, 0x33, 0x33, 0x33, 0x33, 0x00 },  // 'n'
+    { 0x00, 0x00, 0x1E, 0x33, 0x33, 0x33, 0x1E, 0x00 },  // 'o'
+    { 0x00, 0x00, 0x3B, 0x66, 0x66, 0x3E, 0x06, 0x0F },  // 'p'
+    { 0x00, 0x00, 0x6E, 0x33, 0x33, 0x3E, 0x30, 0x78 },  // 'q'
+    { 0x00, 0x00, 0x3B, 0x6E, 0x66, 0x06, 0x0F, 0x00 },  // 'r'
+    { 0x00, 0x00, 0x3E, 0x03, 0x1E, 0x30, 0x1F, 0x00 },  // 's'
+    { 0x08, 0x0C, 0x3E, 0x0C, 0x0C, 0x2C, 0x18, 0x00 },  // 't'
+    { 0x00, 0x00, 0x33, 0x33, 0x33, 0x33, 0x6E, 0x00 },  // 'u'
+    { 0x00, 0x00, 0x33, 0x33, 0x33, 0x1E, 0x0C, 0x00 },  // 'v'
+    { 0x00, 0x00, 0x63, 0x6B, 0x7F, 0x7F, 0x36, 0x00 },  // 'w'
+    { 0x00, 0x00, 0x63, 0x36, 0x1C, 0x36, 0x63, 0x00 },  // 'x'
+    { 0x00, 0x00, 0x33, 0x33, 0x33, 0x3E, 0x30, 0x1F },  // 'y'
+    { 0x00, 0x00, 0x3F, 0x19, 0x0C, 0x26, 0x3F, 0x00 },  // 'z'
+    { 0x38, 0x0C, 0x0C, 0x07, 0x0C, 0x0C, 0x38, 0x00 },  // '{'
+    { 0x18, 0x18, 0x18, 0x00, 0x18, 0x18, 0x18, 0x00 },  // '|'
+    { 0x07, 0x0C, 0x0C, 0x38, 0x0C, 0x0C, 0x07, 0x00 },  // '}'
+    { 0x6E, 0x3B, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 },  // '~'
+};
+
+struct FontGlyph {
+    uint16_t atlas_x;
+    uint16_t atlas_y;
+    uint8_t width;
+    uint8_t advance;
+};
+
+struct FontAtlas {
+    FontGlyph glyphs[FONT_CHARACTER_COUNT];
+    uint8_t coverage[FONT_ATLAS_HEIGHT][FONT_ATLAS_STRIDE];
+};
+
+struct TextLine {
+    int32_t length;
+    char text[TEXT_MAX_LINE_LENGTH];
+};
+
+// Note: A laid-out line: its text, and the glyph coverage it composes to
+struct TextLayout {
+    uint64_t hash;
+    uint64_t last_used;
+
+    TextLine line;
+    int32_t width;
+
+    uint8_t coverage[FONT_GLYPH_HEIGHT][TEXT_LINE_STRIDE];
+};
+
+struct TextLayoutCache {
+    uint64_t use_count;
+    uint64_t hit_count;
+    uint64_t miss_count;
+
+    TextLayout layouts[TEXT_LAYOUT_CACHE_SIZE];
+};
+
+internal void BuildFontAtlas(FontAtlas* atlas) {
+    *atlas = {};
+
+    int shelf_x = 0;
+    int shelf_y = 0;
+
+    for(int character_index = 0; character_index < FONT_CHARACTER_COUNT; ++character_index) {
+        uint8_t* rows = g_font_8x8[character_index];
+        FontGlyph* glyph = &atlas->glyphs[character_index];
+
+        uint32_t inked_columns = 0;
+        for(int row = 0; row < FONT_SOURCE_SIZE; ++row) {
+            inked_columns |= rows[row];
+        }
+
+        if(!inked_columns) {
+            glyph->advance = FONT_SPACE_ADVANCE;
+            continue;
+        }
+
+        int first_column = 0;
+        while(!(inked_columns & (1 << first_column))) {
+            ++first_column;
+        }
+
+        int last_column = FONT_SOURCE_SIZE - 1;
+        while(!(inked_columns & (1 << last_column))) {
+            --last_column;
+        }
+
+        int width = (last_column - first_column + 1) * FONT_SCALE;
+
+        if(shelf_x + width > FONT_ATLAS_WIDTH) {
+            shelf_x = 0;
+            shelf_y += FONT_GLYPH_HEIGHT;
+        }
+
+        Assert(shelf_y + FONT_GLYPH_HEIGHT <= FONT_ATLAS_HEIGHT);
+
+        glyph->atlas_x = static_cast<uint16_t>(shelf_x);
+        glyph->atlas_y = static_cast<uint16_t>(shelf_y);
+        glyph->width = static_cast<uint8_t>(width);
+        glyph->advance = static_cast<uint8_t>(width + FONT_GLYPH_SPACING);
+
+        for(int y = 0; y < FONT_GLYPH_HEIGHT; ++y) {
+            uint8_t source_row = rows[y / FONT_SCALE];
+            uint8_t* dest = &atlas->coverage[shelf_y + y][shelf_x];
+
+            for(int x = 0; x < width; ++x) {
+                int column = first_column + x / FONT_SCALE;
+                dest[x] = static_cast<uint8_t>((source_row & (1 << column)) ? 255 : 0);
+            }
+        }
+
+        shelf_x += width;
+    }
+}
+
+inline void AppendText(TextLine* line, const char* text) {
+    while(*text && line->length < TEXT_MAX_LINE_LENGTH) {
+        line->text[line->length++] = *text++;
+    }
+}
+
+internal void AppendUnsigned(TextLine* line, uint32_t value) {
+    char digits[10];
+    int digit_count = 0;
+
+    do {
+        digits[digit_count++] = static_cast<char>('0' + value % 10);
+        value /= 10;
+    } while(value);
+
+    while(digit_count && line->length < TEXT_MAX_LINE_LENGTH) {
+        line->text[line->length++] = digits[--digit_count];
+    }
+}
+
+// Note: Rounds to decimal_count places. Clamps to what fits in 32 bits, and negative values to zero,
+// since nothing here needs them.
+internal void AppendFixed(TextLine* line, float32 value, int decimal_count) {
+    uint32_t scale = 1;
+    for(int index = 0; index < decimal_count; ++index) {
+        scale *= 10;
+    }
+
+    float32 max_value = 4.0e9f / static_cast<float32>(scale);
+
+    if(value < 0.0f) {
+        value = 0.0f;
+    } else if(value > max_value) {
+        value = max_value;
+    }
+
+    uint32_t scaled = static_cast<uint32_t>(value * static_cast<float32>(scale) + 0.5f);
+    AppendUnsigned(line, scaled / scale);
+
+    if(decimal_count > 0 && line->length < TEXT_MAX_LINE_LENGTH) {
+        line->text[line->length++] = '.';
+
+        uint32_t fraction = scaled % scale;
+        for(uint32_t place = scale / 10; place && line->length < TEXT_MAX_LINE_LENGTH; place /= 10) {
+            line->text[line->length++] = static_cast<char>('0' + (fraction / place) % 10);
+        }
+    }
+}
+
+// Note: FNV-1a
+inline uint64_t HashTextLine(TextLine* line) {
+    uint64_t hash = 14695981039346656037ull;
+
+    for(int32_t index = 0; index < line->length; ++index) {
+        hash ^= static_cast<uint8_t>(line->text[index]);
+        hash *= 1099511628211ull;
+    }
+
+    // Note: Zero marks an empty cache slot
+    if(hash == 0) {
+        hash = 1;
+    }
+
+    return hash;
+}
+
+inline bool32 TextLinesMatch(TextLine* a, TextLine* b) {
+    if(a->length != b->length) {
+        return false;
+    }
+
+    for(int32_t index = 0; index < a->length; ++index) {
+        if(a->text[index] != b->text[index]) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// Note: 16 bytes of 0xFF then 16 of zero. Loading at (16 - n) gives a mask of the first n bytes.
+global_variable uint8_t g_text_byte_masks[32] = {
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+};
+
+internal void LayOutText(FontAtlas* atlas, TextLayout* layout) {
+    for(int y = 0; y < FONT_GLYPH_HEIGHT; ++y) {
+        for(int x = 0; x < TEXT_LINE_STRIDE; x += 16) {
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(&layout->coverage[y][x]), _mm_setzero_si128());
+        }
+    }
+
+    int pen_x = 0;
+
+    for(int32_t index = 0; index < layout->line.length; ++index) {
+        int character_index = static_cast<uint8_t>(layout->line.text[index]) - FONT_FIRST_CHARACTER;
+
+        if(character_index < 0 || character_index >= FONT_CHARACTER_COUNT) {
+            character_index = '?' - FONT_FIRST_CHARACTER;
+        }
+
+        FontGlyph* glyph = &atlas->glyphs[character_index];
+
+        if(pen_x + glyph->width > TEXT_MAX_LINE_WIDTH) {
+            break;
+        }
+
+        if(glyph->width) {
+            // Note: The atlas is packed tight, so mask off whatever the neighbouring glyph left in
+            // the rest of the load
+            __m128i mask = _mm_loadu_si128(reinterpret_cast<__m128i*>(&g_text_byte_masks[16 - glyph->width]));
+
+            for(int y = 0; y < FONT_GLYPH_HEIGHT; ++y) {
+                __m128i* source = reinterpret_cast<__m128i*>(&atlas->coverage[glyph->atlas_y + y][glyph->atlas_x]);
+                __m128i* dest = reinterpret_cast<__m128i*>(&layout->coverage[y][pen_x]);
+
+                __m128i coverage = _mm_and_si128(_mm_loadu_si128(source), mask);
+                _mm_storeu_si128(dest, _mm_or_si128(_mm_loadu_si128(dest), coverage));
+            }
+        }
+
+        pen_x += glyph->advance;
+    }
+
+    layout->width = pen_x > FONT_GLYPH_SPACING ? pen_x - FONT_GLYPH_SPACING : pen_x;
+}
+
+internal TextLayout* GetTextLayout(TextLayoutCache* cache, FontAtlas* atlas, TextLine* line) {
+    uint64_t hash = HashTextLine(line);
+    uint64_t use = ++cache->use_count;
+
+    TextLayout* victim = 0;
+
+    for(int probe = 0; probe < TEXT_LAYOUT_CACHE_PROBE_COUNT; ++probe) {
+        TextLayout* layout = &cache->layouts[(hash + probe) & (TEXT_LAYOUT_CACHE_SIZE - 1)];
+
+        if(layout->hash == hash && TextLinesMatch(&layout->line, line)) {
+            layout->last_used = use;
+            ++cache->hit_count;
+
+            return layout;
+        }
+
+        if(!victim || layout->last_used < victim->last_used) {
+            victim = layout;
+        }
+    }
+
+    ++cache->miss_count;
+
+    victim->hash = hash;
+    victim->last_used = use;
+    victim->line = *line;
+    LayOutText(atlas, victim);
+
+    return victim;
+}
+
+// Note: Color is 0xXXRRGGBB, like the buffer. Returns the width of the text in pixels.
+internal int DrawText(
+        GameOffscreenBuffer* buffer, TextLayoutCache* cache, FontAtlas* atlas, int x, int y, TextLine* line,
+        uint32_t color) {
+    TextLayout* layout = GetTextLayout(cache, atlas, line);
+
+    int min_x = x < 0 ? 0 : x;
+    int min_y = y < 0 ? 0 : y;
+    int max_x = x + layout->width;
+    int max_y = y + FONT_GLYPH_HEIGHT;
+
+    if(max_x > buffer->width) {
+        max_x = buffer->width;
+    }
+
+    if(max_y > buffer->height) {
+        max_y = buffer->height;
+    }
+
+    __m128i zero = _mm_setzero_si128();
+    __m128i color_4x = _mm_set1_epi32(static_cast<int>(color));
+
+    for(int dest_y = min_y; dest_y < max_y; ++dest_y) {
+        uint8_t* coverage = &layout->coverage[dest_y - y][min_x - x];
+        uint32_t* pixel = reinterpret_cast<uint32_t*>(
+            static_cast<uint8_t*>(buffer->memory) + dest_y * buffer->pitch) + min_x;
+        int dest_x = min_x;
+
+        for(; dest_x + 16 <= max_x; dest_x += 16) {
+            __m128i coverage_16x = _mm_loadu_si128(reinterpret_cast<__m128i*>(coverage));
+
+            // Note: Most of a line of text is gaps between strokes
+            if(_mm_movemask_epi8(_mm_cmpeq_epi8(coverage_16x, zero)) != 0xFFFF) {
+                // Note: Widen each coverage byte to a whole pixel, giving a mask of the pixels to set
+                __m128i coverage_low = _mm_unpacklo_epi8(coverage_16x, coverage_16x);
+                __m128i coverage_high = _mm_unpackhi_epi8(coverage_16x, coverage_16x);
+
+                __m128i masks[4];
+                masks[0] = _mm_unpacklo_epi16(coverage_low, coverage_low);
+                masks[1] = _mm_unpackhi_epi16(coverage_low, coverage_low);
+                masks[2] = _mm_unpacklo_epi16(coverage_high, coverage_high);
+                masks[3] = _mm_unpackhi_epi16(coverage_high, coverage_high);
+
+                for(int quad = 0; quad < 4; ++quad) {
+                    __m128i* dest = reinterpret_cast<__m128i*>(pixel + 4 * quad);
+                    __m128i result = _mm_or_si128(
+                        _mm_and_si128(masks[quad], color_4x), _mm_andnot_si128(masks[quad], _mm_loadu_si128(dest)));
+                    _mm_storeu_si128(dest, result);
+                }
+            }
+
+            coverage += 16;
+            pixel += 16;
+        }
+
+        for(; dest_x < max_x; ++dest_x) {
+            if(*coverage++) {
+                *pixel = color;
+            }
+
+            ++pixel;
+        }
+    }
+
+    return layout->width;
+}
+
+#endif  // !WATCHER_TEXT_H
@@ -1,7 +1,16 @@
 #include <windows.h>
 #include <xinput.h>
+#include <psapi.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
 
 #include "watcher_platform.h"
+#include "watcher_input_trace.h"
+#include "watcher_compression.h"
+#include "watcher_input_events.h"
+#include "watcher_memory.h"
+#include "watcher_overlay.h"
 
 // Dynamically loaded XInput functions
 typedef DWORD WINAPI XInputGetStateFunc(DWORD dwUserIndex, XINPUT_STATE* pState);
@@ -19,6 +28,191 @@ DWORD WINAPI XInputSetStateStub(DWORD dwUserIndex, XINPUT_VIBRATION* pVibration)
 global_variable XInputSetStateFunc* XInputSetState_ = XInputSetStateStub;
 #define XInputSetState XInputSetState_
 
+#define WIN32_CHECKPOINT_FILE_MAGIC 0x50434E4E  // "NNCP"
+#define WIN32_CHECKPOINT_RECORD_MAGIC 0x4345524E  // "NREC"
+#define WIN32_CHECKPOINT_INTERVAL_FRAMES 300
+
+// Note: Staging and output memory for up to this many pages stays committed between checkpoints, so
+// everyday ones don't fault fresh pages in. Anything a bigger one (like the first) needed is given
+// back as soon as it's written.
+#define WIN32_CHECKPOINT_RETAINED_PAGES 1024
+
+// Note: The records after the first may add up to this much, or to the first record's own size if
+// that's bigger, before the worker rebases the file
+#define WIN32_CHECKPOINT_MIN_REBASE_SIZE Megabytes(16)
+
+// Note: A checkpoint file is a Win32CheckpointFileHeader followed by records. Each record holds
+// pages, every page prefixed by a Win32CheckpointPageHeader, and restoring means applying all of the
+// records in order. The first record holds every page written before it, and each one after holds
+// the pages written since the record before.
+//
+// Records are only ever appended, so a crash or a failed write can at worst leave a torn record at
+// the end, which is cut off again. Once the records after the first outgrow
+// WIN32_CHECKPOINT_MIN_REBASE_SIZE or the first record, the worker rebases: it copies the latest
+// version of every page out of the file into a single record in a new file, and only moves that over
+// the old file once it has been written completely. So the file size and the restore time are
+// bounded by the memory the game has touched, not by how long the session has run.
+//
+// The file outlives the session. Starting with -resume picks it up again and restores its last
+// checkpoint; starting without it begins a new file.
+struct Win32CheckpointFileHeader {
+    uint32_t magic;
+    uint32_t page_size;
+    uint64_t memory_size;
+};
+
+struct Win32CheckpointRecordHeader {
+    uint32_t magic;
+    uint32_t sequence;
+    uint64_t page_count;
+    uint64_t body_size;
+};
+
+struct Win32CheckpointPageHeader {
+    uint32_t page_index;
+    uint32_t compressed_size;  // Note: Equal to the page size if the page is stored uncompressed
+};
+
+// Note: The heatmap in the report is folded down to about this many characters, in rows of this many
+#define WIN32_MEMORY_HEATMAP_CELL_COUNT 1024
+#define WIN32_MEMORY_HEATMAP_COLUMN_COUNT 64
+
+struct Win32MemoryTelemetry {
+    uint8_t* memory_block;
+    uint64_t memory_size;
+    DWORD sampled_page_fault_count;
+
+    // Note: Scratch for the last look at the write watch, on exit
+    void** written_pages;
+};
+
+struct Win32CheckpointPageLocation {
+    uint64_t offset;  // Note: Of the page's latest data in the file, zero if no record holds the page
+    uint32_t compressed_size;
+};
+
+struct Win32Checkpointer {
+    HANDLE file;
+    HANDLE worker_thread;
+    HANDLE work_ready_event;  // Note: Auto-reset, wakes the worker
+    HANDLE work_done_event;  // Note: Manual-reset, signaled whenever the worker is idle
+    bool32 volatile is_shutting_down;
+
+    char filename[MAX_PATH];
+    char rebase_filename[MAX_PATH];  // Note: Rebased files are written here, then moved over filename
+
+    uint8_t* memory_block;
+    uint64_t memory_size;
+    uint32_t page_size;
+    uint64_t page_count;
+
+    // Note: Optional. Told about every batch of written pages before the write watch is reset.
+    PlatformMemoryStats* memory_stats;
+
+    // Note: Everything from here on belongs to the main thread while the worker is idle, and to the
+    // worker while it's busy
+    void** dirty_pages;
+    uint64_t dirty_page_count;
+    uint8_t* staging_memory;  // Reserved for memory_size, committed as needed
+    uint8_t* output_memory;  // Reserved for the largest possible record, committed as needed
+    uint32_t sequence;
+    float32 pause_seconds;
+
+    // Note: Where the latest copy of every page is in the file, which is what a rebase copies out
+    Win32CheckpointPageLocation* page_locations;
+    uint64_t saved_page_count;
+    uint64_t file_size;
+    uint64_t full_record_size;  // Note: Of the first record
+    uint64_t delta_records_size;  // Note: Of all the records after the first
+
+    // Note: One byte per page, set for pages whose last write to the file failed, which get staged
+    // again with the next checkpoint
+    uint8_t* unsaved_pages;
+    uint64_t unsaved_page_count;
+};
+
+// Note: Must be a power of two
+#define WIN32_WORK_DEQUE_SIZE 4096
+#define WIN32_MAX_WORKER_COUNT 63
+#define WIN32_WORKER_SPIN_COUNT 256
+
+struct Win32WorkEntry {
+    PlatformWorkQueueCallback* callback;
+    void* data;
+};
+
+// Note: Chase-Lev work-stealing deque. Only the owning thread pushes and pops at the bottom, any
+// other thread may steal from the top.
+struct Win32WorkDeque {
+    int64_t volatile top;
+    uint8_t top_padding[64 - sizeof(int64_t)];  // Keep thieves off the owner's cache line
+
+    int64_t volatile bottom;
+    uint8_t bottom_padding[64 - sizeof(int64_t)];
+
+    Win32WorkEntry entries[WIN32_WORK_DEQUE_SIZE];
+};
+
+struct Win32WorkerContext {
+    PlatformWorkQueue* queue;
+    int deque_index;
+
+    // Note: Time spent running work. Only the worker writes it, the main thread samples it once a
+    // frame into sampled_busy_ticks.
+    int64_t volatile busy_ticks;
+    int64_t sampled_busy_ticks;
+
+    uint8_t padding[32];  // Keeps each worker's busy_ticks on its own cache line
+};
+
+struct PlatformWorkQueue {
+    // Note: Deque 0 belongs to the main thread, deque n to worker thread n
+    Win32WorkDeque* deques;
+    int deque_count;
+
+    LONG volatile completion_goal;
+    LONG volatile completion_count;
+
+    // Note: Workers with nothing to do park on the semaphore. Every parked (or about to park) worker
+    // is counted either in sleeping_worker_count or as one unit of the semaphore, never both.
+    HANDLE wake_semaphore;
+    LONG volatile sleeping_worker_count;
+
+    bool32 volatile is_shutting_down;
+    DWORD main_thread_id;
+
+    HANDLE worker_threads[WIN32_MAX_WORKER_COUNT];
+    Win32WorkerContext worker_contexts[WIN32_MAX_WORKER_COUNT];
+};
+
+// Note: Levels step the render resolution down 5% at a time, from full size at level 0 to half size
+#define WIN32_RESOLUTION_LEVEL_COUNT 11
+#define WIN32_RESOLUTION_LEVEL_STEP 0.05f
+#define WIN32_RESOLUTION_WINDOW_FRAMES 30
+#define WIN32_RESOLUTION_TARGET_SECONDS (1.0f / 60.0f)
+
+// Note: Only step back up if the next level's predicted cost fits in this fraction of the target.
+// Without the gap a frame time near the target flips between two levels every window.
+#define WIN32_RESOLUTION_RAISE_THRESHOLD 0.85f
+
+struct Win32ResolutionScaler {
+    int max_width;
+    int max_height;
+    int level;
+    float32 target_seconds;
+
+    // Note: Only holds samples taken since the last change, since older ones were at another size
+    float32 render_seconds[WIN32_RESOLUTION_WINDOW_FRAMES];
+    int sample_count;
+
+    HANDLE trace_file;
+    uint32_t frame_index;
+    int trace_buffer_size;
+    char trace_buffer[Kilobytes(16)];
+};
+
+#define WIN32_MAX_INPUT_COMMANDS_PER_FRAME 64
+
 #define WIN32_STATE_FILE_NAME_COUNT MAX_PATH
 struct Win32State {
     uint64_t total_size;
@@ -26,6 +220,30 @@ struct Win32State {
 
     char executable_filename[WIN32_STATE_FILE_NAME_COUNT];
     char* one_past_last_executable_filename_slash;
+
+    char input_trace_filename[WIN32_STATE_FILE_NAME_COUNT];
+
+    // Note: Recording and playback never overlap, so they share one block of payload memory
+    void* input_trace_block_memory;
+
+    HANDLE recording_handle;
+    InputTraceEncoder recording_encoder;
+    uint64_t recording_encoded_size;
+
+    HANDLE playback_handle;
+    InputTraceDecoder playback_decoder;
+
+    char checkpoint_filename[WIN32_STATE_FILE_NAME_COUNT];
+    Win32Checkpointer checkpointer;
+
+    PlatformWorkQueue work_queue;
+
+    char resolution_trace_filename[WIN32_STATE_FILE_NAME_COUNT];
+    Win32ResolutionScaler resolution_scaler;
+
+    char memory_report_filename[WIN32_STATE_FILE_NAME_COUNT];
+    char memory_pages_filename[WIN32_STATE_FILE_NAME_COUNT];
+    Win32MemoryTelemetry memory_telemetry;
 };
 
 struct Win32GameCode {
@@ -35,6 +253,7 @@ struct Win32GameCode {
     // Note: Can be null, must check before calling
     GameUpdateAndRenderFunc* update_and_render;
     GameGetSoundSamplesFunc* get_sound_samples;
+    GameDrawPerformanceOverlayFunc* draw_performance_overlay;  // Note: Only used by -overlay-bench
 
     bool32 is_valid;
 };
@@ -46,6 +265,11 @@ struct Win32OffscreenBuffer {
     int height;
     int pitch;
     int bytes_per_pixel;
+
+    // Note: The size the memory was allocated for. Rendering may use less than this, but the picture
+    // is always presented at this size.
+    int max_width;
+    int max_height;
 };
 
 struct Win32WindowDimension {
@@ -54,8 +278,12 @@ struct Win32WindowDimension {
 };
 
 // TODO: Make these not global?
-global_variable bool32 g_is_running;
+// Note: Written by the simulation thread, read by the message thread too
+global_variable bool32 volatile g_is_running;
 global_variable Win32OffscreenBuffer g_back_buffer;
+global_variable int64_t g_perf_count_frequency;
+global_variable HANDLE g_console_output;
+global_variable InputEventQueue g_input_events;
 WINDOWPLACEMENT g_previous_window_position = { sizeof(WINDOWPLACEMENT) };
 
 extern "C" {
@@ -121,6 +349,42 @@ inline FILETIME Win32GetLastWriteTime(char* filename) {
     return result;
 }
 
+internal void Win32Log(char* format, ...) {
+    char text[512];
+
+    va_list args;
+    va_start(args, format);
+    _vsnprintf_s(text, sizeof(text), _TRUNCATE, format, args);
+    va_end(args);
+
+    OutputDebugStringA(text);
+
+    if(g_console_output) {
+        DWORD bytes_written;
+        WriteFile(g_console_output, text, GetStringLength_(text), &bytes_written, 0);
+    }
+}
+
+// Note: So command-line runs (benchmarks, headless replay) can report to the console they came from
+internal void Win32AttachParentConsole() {
+    if(AttachConsole(ATTACH_PARENT_PROCESS)) {
+        g_console_output = GetStdHandle(STD_OUTPUT_HANDLE);
+    }
+}
+
+inline LARGE_INTEGER Win32GetWallClock() {
+    LARGE_INTEGER result;
+    QueryPerformanceCounter(&result);
+
+    return result;
+}
+
+inline float32 Win32GetSecondsElapsed(LARGE_INTEGER start, LARGE_INTEGER end) {
+    float32 result = static_cast<float32>(end.QuadPart - start.QuadPart) / static_cast<float32>(g_perf_count_frequency);
+
+    return result;
+}
+
 internal Win32GameCode Win32LoadGameCode(char* source_dll_filename, char* temp_dll_filename, char* lock_filename) {
     Win32GameCode result = {};
     WIN32_FILE_ATTRIBUTE_DATA ignored_;
@@ -139,6 +403,9 @@ internal Win32GameCode Win32LoadGameCode(char* source_dll_filename, char* temp_d
             result.get_sound_samples = reinterpret_cast<GameGetSoundSamplesFunc*>(
                 GetProcAddress(result.game_code_dll, "GameGetSoundSamples"));
 
+            result.draw_performance_overlay = reinterpret_cast<GameDrawPerformanceOverlayFunc*>(
+                GetProcAddress(result.game_code_dll, "GameDrawPerformanceOverlay"));
+
             result.is_valid = result.update_and_render && result.get_sound_samples;
         }
     }
@@ -146,6 +413,7 @@ internal Win32GameCode Win32LoadGameCode(char* source_dll_filename, char* temp_d
     if(!result.is_valid) {
         result.update_and_render = 0;
         result.get_sound_samples = 0;
+        result.draw_performance_overlay = 0;
     }
 
     return result;
@@ -162,6 +430,7 @@ internal void Win32UnloadGameCode(Win32GameCode* game_code) {
     game_code->is_valid = false;
     game_code->update_and_render = 0;
     game_code->get_sound_samples = 0;
+    game_code->draw_performance_overlay = 0;
 }
 
 internal void Win32LoadXInput() {
@@ -216,6 +485,8 @@ internal void Win32ResizeDibSection(Win32OffscreenBuffer* buffer, int width, int
 
     buffer->width = width;
     buffer->height = height;
+    buffer->max_width = width;
+    buffer->max_height = height;
     buffer->bytes_per_pixel = 4;
 
     buffer->info.bmiHeader.biSize = sizeof(buffer->info.bmiHeader);
@@ -231,10 +502,24 @@ internal void Win32ResizeDibSection(Win32OffscreenBuffer* buffer, int width, int
     buffer->pitch = width * buffer->bytes_per_pixel;
 }
 
+// Note: Renders into the top left of the existing memory, keeping the full-size pitch, so changing
+// resolution never reallocates
+internal void Win32SetBufferResolution(Win32OffscreenBuffer* buffer, int width, int height) {
+    Assert(width <= buffer->max_width && height <= buffer->max_height);
+
+    buffer->width = width;
+    buffer->height = height;
+
+    // Note: The DIB still describes full-width rows, only the row count changes
+    buffer->info.bmiHeader.biWidth = buffer->max_width;
+    buffer->info.bmiHeader.biHeight = -height;
+}
+
 internal void Win32DisplayBufferInWindow(
         Win32OffscreenBuffer* buffer, HDC device_context, int window_width, int window_height) {
-    int destination_width = buffer->width;
-    int destination_height = buffer->height;
+    // Note: Sized off the full resolution, so the picture doesn't jump around as the render size changes
+    int destination_width = buffer->max_width;
+    int destination_height = buffer->max_height;
 
     while((window_width >= destination_width * 2) && (window_height >= destination_height * 2)) {
         destination_width *= 2;
@@ -295,13 +580,6 @@ internal void Win32ToggleFullscreen(HWND window) {
     }
 }
 
-internal void Win32ProcessKeyboardMessage(GameButtonState* new_state, bool32 is_down) {
-    if(new_state->ended_down != is_down) {
-        new_state->ended_down = is_down;
-        ++new_state->half_transition_count;
-    }
-}
-
 internal void Win32ProcessXInputDigitalButton(
         DWORD x_input_button_state, GameButtonState* old_state, DWORD button_bit, GameButtonState* new_state) {
     new_state->ended_down = (x_input_button_state & button_bit) == button_bit;
@@ -317,272 +595,2799 @@ internal float32 Win32ProcessXInputStickValue(SHORT value, SHORT dead_zone_thres
         result = static_cast<float32>((value - dead_zone_threshold) / (32767.0f - dead_zone_threshold));
     }
 
+    // Note: Off the grid, every stick change would be recorded as raw float bits
+    result = InputTraceSnapStick(result);
+
     return result;
 }
 
-internal void Win32ProcessPendingMessages(GameControllerInput* keyboard_controller) {
-    MSG message;
+internal void Win32BeginInputRecording(Win32State* state) {
+    Assert(!state->recording_handle && !state->playback_handle);
 
-    while(PeekMessage(&message, 0, 0, 0, PM_REMOVE)) {
-        switch(message.message) {
-            case WM_QUIT: {
-                g_is_running = false;
-                break;
-            }
+    HANDLE file = CreateFileA(state->input_trace_filename, GENERIC_WRITE, 0, 0, CREATE_ALWAYS, 0, 0);
 
-            case WM_SYSKEYDOWN:
-            case WM_SYSKEYUP:
-            case WM_KEYDOWN:
-            case WM_KEYUP: {
-                uint32_t vk_code = static_cast<uint32_t>(message.wParam);
+    if(file == INVALID_HANDLE_VALUE) {
+        Win32Log("Couldn't create input trace %s\n", state->input_trace_filename);
+        return;
+    }
 
-                bool32 was_down = (message.lParam & (1 << 30)) != 0;
-                bool32 is_down = (message.lParam & (1 << 31)) == 0;
+    InputTraceFileHeader header = {};
+    header.magic = INPUT_TRACE_FILE_MAGIC;
+    header.version = INPUT_TRACE_VERSION;
+    header.frames_per_block = INPUT_TRACE_FRAMES_PER_BLOCK;
+    header.input_size = static_cast<uint32_t>(sizeof(GameInput));
 
-                if(was_down != is_down) {
-                    switch(vk_code) {
-                        case 'W': {
-                            Win32ProcessKeyboardMessage(&keyboard_controller->move_up, is_down);
-                            break;
-                        }
-                        case 'A': {
-                            Win32ProcessKeyboardMessage(&keyboard_controller->move_left, is_down);
-                            break;
-                        }
-                        case 'S': {
-                            Win32ProcessKeyboardMessage(&keyboard_controller->move_down, is_down);
-                            break;
-                        }
-                        case 'D': {
-                            Win32ProcessKeyboardMessage(&keyboard_controller->move_right, is_down);
-                            break;
-                        }
-                        case 'Q': {
-                            Win32ProcessKeyboardMessage(&keyboard_controller->left_shoulder, is_down);
-                            break;
-                        }
-                        case 'E': {
-                            Win32ProcessKeyboardMessage(&keyboard_controller->right_shoulder, is_down);
-                            break;
-                        }
-                        case VK_UP: {
-                            Win32ProcessKeyboardMessage(&keyboard_controller->action_up, is_down);
-                            break;
-                        }
-                        case VK_LEFT: {
-                            Win32ProcessKeyboardMessage(&keyboard_controller->action_left, is_down);
-                            break;
-                        }
-                        case VK_DOWN: {
-                            Win32ProcessKeyboardMessage(&keyboard_controller->action_down, is_down);
-                            break;
-                        }
-                        case VK_RIGHT: {
-                            Win32ProcessKeyboardMessage(&keyboard_controller->action_right, is_down);
-                            break;
-                        }
-                        case VK_ESCAPE: {
-                            Win32ProcessKeyboardMessage(&keyboard_controller->back, is_down);
-                            break;
-                        }
-                        case VK_SPACE: {
-                            Win32ProcessKeyboardMessage(&keyboard_controller->start, is_down);
-                            break;
-                        }
-                    }
+    DWORD bytes_written;
+    WriteFile(file, &header, sizeof(header), &bytes_written, 0);
 
-                    if(is_down) {
-                        bool32 alt_key_is_down = message.lParam & (1 << 29);
+    state->recording_handle = file;
+    state->recording_encoded_size = sizeof(header);
+    InputTraceBeginEncoder(
+        &state->recording_encoder, state->input_trace_block_memory, INPUT_TRACE_MAX_BLOCK_PAYLOAD_SIZE);
+}
 
-                        if(vk_code == VK_F4 && alt_key_is_down) {
-                            g_is_running = false;
-                        }
+internal void Win32WriteInputTraceBlock(Win32State* state) {
+    InputTraceEncoder* encoder = &state->recording_encoder;
 
-                        if(vk_code == VK_RETURN && alt_key_is_down && message.hwnd) {
-                            Win32ToggleFullscreen(message.hwnd);
-                        }
-                    }
-                }
+    if(encoder->frame_count > 0) {
+        InputTraceBlockHeader header;
+        InputTraceFinishBlock(encoder, &header);
 
-                break;
-            }
+        DWORD bytes_written;
+        WriteFile(state->recording_handle, &header, sizeof(header), &bytes_written, 0);
+        WriteFile(state->recording_handle, encoder->writer.base, header.payload_size, &bytes_written, 0);
+        state->recording_encoded_size += sizeof(header) + header.payload_size;
 
-            default: {
-                TranslateMessage(&message);
-                DispatchMessageA(&message);
-                break;
-            }
-        }
+        InputTraceBeginBlock(encoder);
     }
 }
 
-internal LRESULT CALLBACK Win32MainWindowCallback(HWND window, UINT message, WPARAM w_param, LPARAM l_param) {
-    LRESULT result = 0;
+internal void Win32RecordInput(Win32State* state, GameInput* input) {
+    if(InputTraceEncodeFrame(&state->recording_encoder, input)) {
+        Win32WriteInputTraceBlock(state);
+    }
+}
 
-    switch(message) {
-        case WM_CLOSE: {
-            g_is_running = false;
-            break;
-        }
+internal void Win32EndInputRecording(Win32State* state) {
+    Win32WriteInputTraceBlock(state);
+    CloseHandle(state->recording_handle);
+    state->recording_handle = 0;
+
+    uint32_t frame_count = state->recording_encoder.first_frame_index;
+    uint64_t raw_size = static_cast<uint64_t>(frame_count) * sizeof(GameInput);
+    Win32Log(
+        "Recorded %u frames of input: %llu bytes packed into %llu (%.1f:1)\n",
+        frame_count, raw_size, state->recording_encoded_size,
+        static_cast<double>(raw_size) / static_cast<double>(state->recording_encoded_size));
+}
 
-        case WM_SETCURSOR: {
-            SetCursor(0);
-            break;
-        }
+// Note: Reads and validates the next block, leaving the decoder positioned at its first frame
+internal bool32 Win32ReadInputTraceBlock(HANDLE file, InputTraceDecoder* decoder, void* payload_memory) {
+    InputTraceBlockHeader header;
+    DWORD bytes_read;
 
-        case WM_ACTIVATEAPP: {
-            break;
-        }
+    if(!ReadFile(file, &header, sizeof(header), &bytes_read, 0) || bytes_read != sizeof(header) ||
+            !InputTraceIsBlockHeaderValid(&header)) {
+        return false;
+    }
 
-        case WM_DESTROY: {
-            g_is_running = false;
-            break;
-        }
+    if(!ReadFile(file, payload_memory, header.payload_size, &bytes_read, 0) || bytes_read != header.payload_size) {
+        return false;
+    }
 
-        case WM_SYSKEYDOWN:
-        case WM_SYSKEYUP:
-        case WM_KEYDOWN:
-        case WM_KEYUP: {
-            Assert(!"Keyboard input came in through a non-dispatch message!");
-            break;
+    return InputTraceBeginDecodeBlock(decoder, &header, payload_memory);
+}
+
+// Note: Skips whole blocks by their headers, so only the block containing frame_index gets decoded
+internal bool32 Win32SeekInputTrace(
+        HANDLE file, uint32_t frame_index, InputTraceDecoder* decoder, void* payload_memory) {
+    LARGE_INTEGER offset;
+    offset.QuadPart = sizeof(InputTraceFileHeader);
+    SetFilePointerEx(file, offset, 0, FILE_BEGIN);
+
+    for(;;) {
+        InputTraceBlockHeader header;
+        DWORD bytes_read;
+
+        if(!ReadFile(file, &header, sizeof(header), &bytes_read, 0) || bytes_read != sizeof(header) ||
+                !InputTraceIsBlockHeaderValid(&header)) {
+            return false;
         }
 
-        case WM_PAINT: {
-            PAINTSTRUCT paint;
-            HDC device_context = BeginPaint(window, &paint);
-            Win32WindowDimension dimension = Win32GetWindowDimension(window);
-            Win32DisplayBufferInWindow(&g_back_buffer, device_context, dimension.width, dimension.height);
-            EndPaint(window, &paint);
+        if(frame_index < header.first_frame_index + header.frame_count) {
+            offset.QuadPart = -static_cast<int64_t>(sizeof(header));
+            SetFilePointerEx(file, offset, 0, FILE_CURRENT);
             break;
         }
 
-        default: {
-            result = DefWindowProc(window, message, w_param, l_param);
-            break;
+        offset.QuadPart = header.payload_size;
+        SetFilePointerEx(file, offset, 0, FILE_CURRENT);
+    }
+
+    if(!Win32ReadInputTraceBlock(file, decoder, payload_memory)) {
+        return false;
+    }
+
+    GameInput skipped_input;
+
+    while(decoder->next_frame_index < frame_index) {
+        if(!InputTraceDecodeFrame(decoder, &skipped_input)) {
+            return false;
         }
     }
 
-    return result;
+    return true;
 }
 
-int CALLBACK WinMain(HINSTANCE instance, HINSTANCE _unused, LPSTR command_line, int show_code) {
-    Win32State win32_state = {};
+internal HANDLE Win32OpenInputTrace(char* filename) {
+    HANDLE result = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, 0, 0);
 
-    Win32GetExecutableFileName(&win32_state);
+    if(result != INVALID_HANDLE_VALUE) {
+        InputTraceFileHeader header;
+        DWORD bytes_read;
 
-    char source_game_code_dll_full_path[WIN32_STATE_FILE_NAME_COUNT];
-    Win32BuildExecutablePathFileName(
-        &win32_state, "watcher.dll", sizeof(source_game_code_dll_full_path), source_game_code_dll_full_path);
+        if(!ReadFile(result, &header, sizeof(header), &bytes_read, 0) || bytes_read != sizeof(header) ||
+                !InputTraceIsFileHeaderValid(&header)) {
+            CloseHandle(result);
+            result = INVALID_HANDLE_VALUE;
+        }
+    }
 
-    char temp_game_code_dll_full_path[WIN32_STATE_FILE_NAME_COUNT];
-    Win32BuildExecutablePathFileName(
-        &win32_state, "watcher_temp.dll", sizeof(temp_game_code_dll_full_path), temp_game_code_dll_full_path);
+    if(result == INVALID_HANDLE_VALUE) {
+        Win32Log("Couldn't open input trace %s\n", filename);
+    }
 
-    char game_code_lock_full_path[WIN32_STATE_FILE_NAME_COUNT];
-    Win32BuildExecutablePathFileName(
-        &win32_state, "lock.tmp", sizeof(game_code_lock_full_path), game_code_lock_full_path);
+    return result;
+}
 
-    Win32LoadXInput();
+internal void Win32EndInputPlayback(Win32State* state) {
+    CloseHandle(state->playback_handle);
+    state->playback_handle = 0;
+}
 
-    WNDCLASS window_class = {};
+internal void Win32BeginInputPlayback(Win32State* state) {
+    Assert(!state->recording_handle && !state->playback_handle);
 
-    Win32ResizeDibSection(&g_back_buffer, 960, 540);
+    HANDLE file = Win32OpenInputTrace(state->input_trace_filename);
 
-    window_class.style = CS_HREDRAW | CS_VREDRAW;
-    window_class.lpfnWndProc = Win32MainWindowCallback;
-    window_class.hInstance = instance;
-    window_class.hCursor = LoadCursor(0, IDC_ARROW);
-    // window_class.hIcon = ;
-    window_class.lpszClassName = "NamelessWatcherWindowClass";
+    if(file != INVALID_HANDLE_VALUE) {
+        state->playback_handle = file;
 
-    if(!RegisterClass(&window_class)) {
-        // TODO: Log
-        return -1;
+        if(!Win32SeekInputTrace(file, 0, &state->playback_decoder, state->input_trace_block_memory)) {
+            Win32Log("Input trace %s is empty or damaged\n", state->input_trace_filename);
+            Win32EndInputPlayback(state);
+        }
     }
+}
 
-    HWND window = CreateWindowEx(
-        0, window_class.lpszClassName, "Nameless Watcher", WS_OVERLAPPEDWINDOW | WS_VISIBLE,
-        CW_USEDEFAULT, CW_USEDEFAULT, CW_USEDEFAULT, CW_USEDEFAULT, 0, 0, instance, 0);
+internal void Win32PlayBackInput(Win32State* state, GameInput* input) {
+    InputTraceDecoder* decoder = &state->playback_decoder;
+    void* payload_memory = state->input_trace_block_memory;
 
-    if(!window) {
-        // TODO: Log
-        return -1;
+    if(InputTraceDecodeFrame(decoder, input)) {
+        return;
     }
 
-    g_is_running = true;
+    if(Win32ReadInputTraceBlock(state->playback_handle, decoder, payload_memory) &&
+            InputTraceDecodeFrame(decoder, input)) {
+        return;
+    }
 
-    GameInput input[2] = {};
-    GameInput* new_input = &input[0];
-    GameInput* old_input = &input[1];
+    // Note: Out of frames, so loop back around to the start of the trace
+    if(!Win32SeekInputTrace(state->playback_handle, 0, decoder, payload_memory) ||
+            !InputTraceDecodeFrame(decoder, input)) {
+        Win32Log("Input trace playback failed, stopping\n");
+        Win32EndInputPlayback(state);
+    }
+}
 
-    Win32GameCode game = Win32LoadGameCode(
-        source_game_code_dll_full_path, temp_game_code_dll_full_path, game_code_lock_full_path);
+internal bool32 Win32WriteEntireBuffer(HANDLE file, void* memory, uint64_t size) {
+    uint8_t* at = static_cast<uint8_t*>(memory);
 
-    while(g_is_running) {
-        FILETIME new_dll_write_time = Win32GetLastWriteTime(source_game_code_dll_full_path);
+    while(size > 0) {
+        DWORD chunk_size = size > Gigabytes(1) ? static_cast<DWORD>(Gigabytes(1)) : static_cast<DWORD>(size);
+        DWORD bytes_written;
 
-        if(CompareFileTime(&new_dll_write_time, &game.dll_last_write_time) != 0) {
-            Win32UnloadGameCode(&game);
-            game = Win32LoadGameCode(
-                source_game_code_dll_full_path, temp_game_code_dll_full_path, game_code_lock_full_path);
+        if(!WriteFile(file, at, chunk_size, &bytes_written, 0) || bytes_written != chunk_size) {
+            return false;
         }
 
-        GameControllerInput* old_keyboard_controller = GetController(old_input, 0);
-        GameControllerInput* new_keyboard_controller = GetController(new_input, 0);
-        *new_keyboard_controller = {};
-        new_keyboard_controller->is_connected = true;
+        at += chunk_size;
+        size -= chunk_size;
+    }
 
-        for(int button_index = 0; button_index < NUM_SUPPORTED_CONTROLLER_BUTTONS; ++button_index) {
-            new_keyboard_controller->buttons[button_index].ended_down =
-                old_keyboard_controller->buttons[button_index].ended_down;
-        }
+    return true;
+}
 
-        Win32ProcessPendingMessages(new_keyboard_controller);
+internal bool32 Win32ReadEntireBuffer(HANDLE file, void* memory, uint64_t size) {
+    uint8_t* at = static_cast<uint8_t*>(memory);
 
-        POINT mouse_pos;
-        GetCursorPos(&mouse_pos);
-        ScreenToClient(window, &mouse_pos);
+    while(size > 0) {
+        DWORD chunk_size = size > Gigabytes(1) ? static_cast<DWORD>(Gigabytes(1)) : static_cast<DWORD>(size);
+        DWORD bytes_read;
 
-        new_input->mouse_x = mouse_pos.x;
-        new_input->mouse_y = mouse_pos.y;
-        new_input->mouse_z = 0;
+        if(!ReadFile(file, at, chunk_size, &bytes_read, 0) || bytes_read != chunk_size) {
+            return false;
+        }
 
-        Win32ProcessKeyboardMessage(&new_input->mouse_buttons[0], GetKeyState(VK_LBUTTON) & (1 << 15));
-        Win32ProcessKeyboardMessage(&new_input->mouse_buttons[1], GetKeyState(VK_MBUTTON) & (1 << 15));
-        Win32ProcessKeyboardMessage(&new_input->mouse_buttons[2], GetKeyState(VK_RBUTTON) & (1 << 15));
-        Win32ProcessKeyboardMessage(&new_input->mouse_buttons[3], GetKeyState(VK_XBUTTON1) & (1 << 15));
-        Win32ProcessKeyboardMessage(&new_input->mouse_buttons[4], GetKeyState(VK_XBUTTON2) & (1 << 15));
+        at += chunk_size;
+        size -= chunk_size;
+    }
 
-        DWORD MaxControllerCount = XUSER_MAX_COUNT;
+    return true;
+}
 
-        for (DWORD controller_index = 0; controller_index < MaxControllerCount; ++controller_index) {
-            DWORD our_controller_index = controller_index + 1;
-            GameControllerInput* old_controller = GetController(old_input, our_controller_index);
-            GameControllerInput* new_controller = GetController(new_input, our_controller_index);
+internal void Win32WriteText(HANDLE file, char* format, ...) {
+    char text[512];
 
-            XINPUT_STATE controller_state;
+    va_list args;
+    va_start(args, format);
+    _vsnprintf_s(text, sizeof(text), _TRUNCATE, format, args);
+    va_end(args);
 
-            if(XInputGetState(controller_index, &controller_state) == ERROR_SUCCESS) {
-                new_controller->is_connected = true;
-                new_controller->is_analog = old_controller->is_analog;
+    DWORD bytes_written;
+    WriteFile(file, text, GetStringLength_(text), &bytes_written, 0);
+}
 
-                XINPUT_GAMEPAD* pad = &controller_state.Gamepad;
+// Note: Whatever wrote the pages has to call this before resetting the write watch, or those writes
+// are never counted
+internal void Win32RecordWrittenPages(
+        PlatformMemoryStats* stats, void* memory_block, void** written_pages, uint64_t written_page_count) {
+    if(!stats || !stats->page_write_counts || written_page_count == 0) {
+        return;
+    }
 
-                new_controller->stick_average_x = Win32ProcessXInputStickValue(
-                    pad->sThumbLX, XINPUT_GAMEPAD_LEFT_THUMB_DEADZONE);
-                new_controller->stick_average_y = Win32ProcessXInputStickValue(
-                    pad->sThumbLY, XINPUT_GAMEPAD_LEFT_THUMB_DEADZONE);
+    for(uint64_t written_index = 0; written_index < written_page_count; ++written_index) {
+        uint64_t page_index = static_cast<uint64_t>(
+            static_cast<uint8_t*>(written_pages[written_index]) - static_cast<uint8_t*>(memory_block)) /
+            stats->page_size;
+        Assert(page_index < stats->page_count);
 
-                if(new_controller->stick_average_x != 0.0f || new_controller->stick_average_y != 0.0f) {
-                    new_controller->is_analog = true;
-                }
+        uint16_t* write_count = &stats->page_write_counts[page_index];
 
-                if(pad->wButtons & XINPUT_GAMEPAD_DPAD_UP) {
-                    new_controller->stick_average_y = 1.0f;
-                    new_controller->is_analog = false;
-                }
+        if(*write_count == 0) {
+            ++stats->touched_page_count;
+        }
 
-                if(pad->wButtons & XINPUT_GAMEPAD_DPAD_DOWN) {
+        if(*write_count < 0xFFFF) {
+            ++*write_count;
+        }
+    }
+
+    ++stats->write_interval_count;
+}
+
+// Note: Windows only counts page faults as a whole, it doesn't split out the ones that had to go to disk
+internal void Win32SampleMemoryStats(Win32MemoryTelemetry* telemetry, PlatformMemoryStats* stats) {
+    PROCESS_MEMORY_COUNTERS counters = {};
+    counters.cb = sizeof(counters);
+
+    if(!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+        return;
+    }
+
+    // Note: The process counter is only 32 bits, so keep the running total here
+    stats->frame_page_fault_count = counters.PageFaultCount - telemetry->sampled_page_fault_count;
+    telemetry->sampled_page_fault_count = counters.PageFaultCount;
+    stats->page_fault_count += stats->frame_page_fault_count;
+
+    if(stats->frame_page_fault_count > stats->peak_frame_page_fault_count) {
+        stats->peak_frame_page_fault_count = stats->frame_page_fault_count;
+    }
+
+    stats->resident_bytes = counters.WorkingSetSize;
+    stats->peak_resident_bytes = counters.PeakWorkingSetSize;
+    stats->committed_bytes = counters.PagefileUsage;
+}
+
+// Note: memory_block must have been allocated with MEM_WRITE_WATCH
+internal void Win32BeginMemoryTelemetry(
+        Win32MemoryTelemetry* telemetry, PlatformMemoryStats* stats, void* memory_block, uint64_t memory_size) {
+    *telemetry = {};
+
+    SYSTEM_INFO system_info;
+    GetSystemInfo(&system_info);
+
+    telemetry->memory_block = static_cast<uint8_t*>(memory_block);
+    telemetry->memory_size = memory_size;
+
+    stats->page_size = system_info.dwPageSize;
+    stats->page_count = (memory_size + stats->page_size - 1) / stats->page_size;
+
+    telemetry->written_pages = static_cast<void**>(VirtualAlloc(
+        0, stats->page_count * sizeof(void*), MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE));
+    stats->page_write_counts = static_cast<uint16_t*>(VirtualAlloc(
+        0, stats->page_count * sizeof(uint16_t), MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE));
+
+    if(!telemetry->written_pages || !stats->page_write_counts) {
+        Win32Log("Couldn't set up a heatmap for %llu pages, not tracking touched memory\n", stats->page_count);
+
+        VirtualFree(telemetry->written_pages, 0, MEM_RELEASE);
+        VirtualFree(stats->page_write_counts, 0, MEM_RELEASE);
+        telemetry->written_pages = 0;
+        stats->page_write_counts = 0;
+    }
+
+    // Note: Startup faults count towards the total, but don't belong to any frame
+    Win32SampleMemoryStats(telemetry, stats);
+    stats->frame_page_fault_count = 0;
+    stats->peak_frame_page_fault_count = 0;
+}
+
+// Note: Each heatmap character covers a run of pages, and shows what fraction of them were touched
+internal void Win32WriteMemoryHeatmap(HANDLE file, PlatformMemoryStats* stats) {
+    char* shades = " .:-=+*#%@";
+    int32_t shade_count = GetStringLength_(shades);
+
+    uint64_t cell_page_count = (stats->page_count + WIN32_MEMORY_HEATMAP_CELL_COUNT - 1) /
+        WIN32_MEMORY_HEATMAP_CELL_COUNT;
+    if(cell_page_count == 0) {
+        cell_page_count = 1;
+    }
+
+    Win32WriteText(
+        file, "\nHeatmap: each character is %llu pages (%llu KB), '%c' untouched up to '%c' all touched\n",
+        cell_page_count, cell_page_count * stats->page_size / Kilobytes(1), shades[0], shades[shade_count - 1]);
+
+    char row[WIN32_MEMORY_HEATMAP_COLUMN_COUNT + 1];
+    int row_length = 0;
+    uint64_t row_first_page = 0;
+
+    for(uint64_t first_page = 0; first_page < stats->page_count; first_page += cell_page_count) {
+        uint64_t end_page = first_page + cell_page_count;
+        if(end_page > stats->page_count) {
+            end_page = stats->page_count;
+        }
+
+        uint64_t touched_count = 0;
+        for(uint64_t page_index = first_page; page_index < end_page; ++page_index) {
+            if(stats->page_write_counts[page_index]) {
+                ++touched_count;
+            }
+        }
+
+        // Note: Anything touched at all gets at least the faintest mark, so it can't hide as a blank
+        int32_t shade = 0;
+        if(touched_count) {
+            shade = 1 + static_cast<int32_t>(
+                touched_count * static_cast<uint64_t>(shade_count - 2) / (end_page - first_page));
+        }
+
+        if(row_length == 0) {
+            row_first_page = first_page;
+        }
+
+        row[row_length++] = shades[shade];
+
+        if(row_length == WIN32_MEMORY_HEATMAP_COLUMN_COUNT || end_page == stats->page_count) {
+            row[row_length] = 0;
+            Win32WriteText(file, "0x%010llx |%s|\n", row_first_page * stats->page_size, row);
+            row_length = 0;
+        }
+    }
+}
+
+// Note: Counts the writes since the last reset as one more interval, then writes a summary and the
+// heatmap to report_filename, and every touched page's write count to pages_filename
+internal void Win32EndMemoryTelemetry(
+        Win32MemoryTelemetry* telemetry, PlatformMemoryStats* stats, char* report_filename, char* pages_filename) {
+    if(telemetry->written_pages) {
+        ULONG_PTR written_page_count = stats->page_count;
+        DWORD granularity;
+
+        if(GetWriteWatch(
+                0, telemetry->memory_block, telemetry->memory_size,
+                telemetry->written_pages, &written_page_count, &granularity) == 0) {
+            Win32RecordWrittenPages(stats, telemetry->memory_block, telemetry->written_pages, written_page_count);
+        }
+    }
+
+    Win32SampleMemoryStats(telemetry, stats);
+
+    float32 touched_megabytes =
+        static_cast<float32>(stats->touched_page_count * stats->page_size) / static_cast<float32>(Megabytes(1));
+    float32 peak_resident_megabytes =
+        static_cast<float32>(stats->peak_resident_bytes) / static_cast<float32>(Megabytes(1));
+
+    Win32Log(
+        "Game memory: %.1fMB of %.1fMB touched, %.1fMB peak resident, %llu page faults (%u in the worst frame)\n",
+        touched_megabytes, static_cast<float32>(telemetry->memory_size) / static_cast<float32>(Megabytes(1)),
+        peak_resident_megabytes, stats->page_fault_count, stats->peak_frame_page_fault_count);
+
+    HANDLE report_file = CreateFileA(report_filename, GENERIC_WRITE, FILE_SHARE_READ, 0, CREATE_ALWAYS, 0, 0);
+
+    if(report_file == INVALID_HANDLE_VALUE) {
+        Win32Log("Couldn't create memory report %s\n", report_filename);
+    } else {
+        Win32WriteText(
+            report_file, "Permanent storage: %llu bytes, %llu pages of %u bytes\n",
+            telemetry->memory_size, stats->page_count, stats->page_size);
+        Win32WriteText(
+            report_file, "Touched: %llu pages (%.1fMB, %.1f%%) over %u write intervals\n",
+            stats->touched_page_count, touched_megabytes,
+            stats->page_count ? 100.0f * static_cast<float32>(stats->touched_page_count) /
+                static_cast<float32>(stats->page_count) : 0.0f,
+            stats->write_interval_count);
+        Win32WriteText(
+            report_file, "Resident: %llu bytes at exit, %llu bytes peak\n",
+            stats->resident_bytes, stats->peak_resident_bytes);
+        Win32WriteText(report_file, "Committed: %llu bytes at exit\n", stats->committed_bytes);
+        Win32WriteText(
+            report_file, "Page faults: %llu, %u in the worst frame\n",
+            stats->page_fault_count, stats->peak_frame_page_fault_count);
+
+        Win32WriteText(report_file, "\n%-24s %14s %14s %14s %10s\n", "Arena", "Size", "Used", "Peak", "Max temp");
+
+        for(int32_t arena_index = 0; arena_index < stats->arena_count; ++arena_index) {
+            PlatformArenaStats* arena = &stats->arenas[arena_index];
+            Win32WriteText(
+                report_file, "%-24s %14llu %14llu %14llu %10d\n",
+                arena->name, arena->size, arena->used, arena->peak_used, arena->max_temp_count);
+        }
+
+        if(stats->page_write_counts) {
+            Win32WriteMemoryHeatmap(report_file, stats);
+        }
+
+        CloseHandle(report_file);
+    }
+
+    if(stats->page_write_counts) {
+        HANDLE pages_file = CreateFileA(pages_filename, GENERIC_WRITE, FILE_SHARE_READ, 0, CREATE_ALWAYS, 0, 0);
+
+        if(pages_file == INVALID_HANDLE_VALUE) {
+            Win32Log("Couldn't create page heatmap %s\n", pages_filename);
+        } else {
+            // Note: Batched, since there can be a line for every page in the block
+            char buffer[Kilobytes(16)];
+            int buffer_size = _snprintf_s(buffer, sizeof(buffer), _TRUNCATE, "page,offset,write_intervals\n");
+            DWORD bytes_written;
+
+            for(uint64_t page_index = 0; page_index < stats->page_count; ++page_index) {
+                if(stats->page_write_counts[page_index]) {
+                    if(buffer_size > static_cast<int>(sizeof(buffer)) - 64) {
+                        WriteFile(pages_file, buffer, buffer_size, &bytes_written, 0);
+                        buffer_size = 0;
+                    }
+
+                    int line_size = _snprintf_s(
+                        buffer + buffer_size, sizeof(buffer) - buffer_size, _TRUNCATE, "%llu,%llu,%u\n",
+                        page_index, page_index * stats->page_size, stats->page_write_counts[page_index]);
+
+                    if(line_size > 0) {
+                        buffer_size += line_size;
+                    }
+                }
+            }
+
+            WriteFile(pages_file, buffer, buffer_size, &bytes_written, 0);
+            CloseHandle(pages_file);
+        }
+    }
+
+    VirtualFree(telemetry->written_pages, 0, MEM_RELEASE);
+    VirtualFree(stats->page_write_counts, 0, MEM_RELEASE);
+    stats->page_write_counts = 0;
+    *telemetry = {};
+}
+
+inline uint64_t Win32GetCheckpointRecordMaxSize(Win32Checkpointer* checkpointer, uint64_t page_count) {
+    // Note: Pages are compressed in place, so the last one needs room for the codec's worst case
+    uint64_t result =
+        sizeof(Win32CheckpointRecordHeader) +
+        page_count * (sizeof(Win32CheckpointPageHeader) + checkpointer->page_size) +
+        LzMaxCompressedSize(checkpointer->page_size);
+
+    return result;
+}
+
+inline bool32 Win32SeekFile(HANDLE file, uint64_t offset) {
+    LARGE_INTEGER distance;
+    distance.QuadPart = static_cast<LONGLONG>(offset);
+
+    bool32 result = SetFilePointerEx(file, distance, 0, FILE_BEGIN);
+
+    return result;
+}
+
+// Note: Decommits whatever staging and output memory is past what WIN32_CHECKPOINT_RETAINED_PAGES
+// needs. Only call while the worker is idle, or from the worker itself.
+internal void Win32TrimCheckpointMemory(Win32Checkpointer* checkpointer) {
+    uint64_t page_mask = checkpointer->page_size - 1;
+
+    uint64_t staging_size = checkpointer->page_count * checkpointer->page_size;
+    uint64_t retained_staging_size = WIN32_CHECKPOINT_RETAINED_PAGES * static_cast<uint64_t>(checkpointer->page_size);
+
+    if(retained_staging_size < staging_size) {
+        VirtualFree(
+            checkpointer->staging_memory + retained_staging_size, staging_size - retained_staging_size, MEM_DECOMMIT);
+    }
+
+    uint64_t output_size = Win32GetCheckpointRecordMaxSize(checkpointer, checkpointer->page_count);
+    uint64_t retained_output_size =
+        (Win32GetCheckpointRecordMaxSize(checkpointer, WIN32_CHECKPOINT_RETAINED_PAGES) + page_mask) & ~page_mask;
+
+    if(retained_output_size < output_size) {
+        VirtualFree(
+            checkpointer->output_memory + retained_output_size, output_size - retained_output_size, MEM_DECOMMIT);
+    }
+}
+
+// Note: Reads the record at the file pointer into output memory, and checks that every page header
+// in it stays within it. Returns false if there isn't a whole, well-formed record there.
+internal bool32 Win32ReadCheckpointRecord(Win32Checkpointer* checkpointer, Win32CheckpointRecordHeader* record_header) {
+    if(!Win32ReadEntireBuffer(checkpointer->file, record_header, sizeof(*record_header)) ||
+            record_header->magic != WIN32_CHECKPOINT_RECORD_MAGIC ||
+            record_header->page_count == 0 ||
+            record_header->page_count > checkpointer->page_count) {
+        return false;
+    }
+
+    uint64_t body_max_size =
+        Win32GetCheckpointRecordMaxSize(checkpointer, record_header->page_count) - sizeof(*record_header);
+
+    if(record_header->body_size > body_max_size ||
+            !VirtualAlloc(checkpointer->output_memory, record_header->body_size, MEM_COMMIT, PAGE_READWRITE) ||
+            !Win32ReadEntireBuffer(checkpointer->file, checkpointer->output_memory, record_header->body_size)) {
+        return false;
+    }
+
+    uint8_t* at = checkpointer->output_memory;
+    uint8_t* end = at + record_header->body_size;
+
+    for(uint64_t page_index = 0; page_index < record_header->page_count; ++page_index) {
+        if(static_cast<uint64_t>(end - at) < sizeof(Win32CheckpointPageHeader)) {
+            return false;
+        }
+
+        Win32CheckpointPageHeader* page_header = reinterpret_cast<Win32CheckpointPageHeader*>(at);
+        at += sizeof(Win32CheckpointPageHeader);
+
+        if(page_header->page_index >= checkpointer->page_count ||
+                page_header->compressed_size > checkpointer->page_size ||
+                page_header->compressed_size > static_cast<uint64_t>(end - at)) {
+            return false;
+        }
+
+        at += page_header->compressed_size;
+    }
+
+    return true;
+}
+
+// Note: Points every page in a record at its data. record_offset is where the record starts in the
+// file, and record_body is where its body was read or built.
+internal void Win32LocateCheckpointPages(
+        Win32Checkpointer* checkpointer, uint64_t record_offset, uint8_t* record_body, uint64_t page_count) {
+    uint8_t* at = record_body;
+
+    for(uint64_t page_index = 0; page_index < page_count; ++page_index) {
+        Win32CheckpointPageHeader* page_header = reinterpret_cast<Win32CheckpointPageHeader*>(at);
+        at += sizeof(Win32CheckpointPageHeader);
+
+        Win32CheckpointPageLocation* location = &checkpointer->page_locations[page_header->page_index];
+
+        if(!location->offset) {
+            ++checkpointer->saved_page_count;
+        }
+
+        location->offset = record_offset + sizeof(Win32CheckpointRecordHeader) + (at - record_body);
+        location->compressed_size = page_header->compressed_size;
+
+        at += page_header->compressed_size;
+    }
+}
+
+// Note: Runs on the worker thread. Copies the latest version of every page out of the file, into a
+// single record in a new file, and moves that over the old file once it's safely written. Until then
+// the old file is left alone, so failing at any point loses nothing.
+internal bool32 Win32RebaseCheckpointFile(Win32Checkpointer* checkpointer) {
+    LARGE_INTEGER rebase_start = Win32GetWallClock();
+
+    // Note: The pages go through the retained part of the staging memory, which the checkpoint that
+    // was just written is done with
+    uint64_t buffer_capacity = WIN32_CHECKPOINT_RETAINED_PAGES * static_cast<uint64_t>(checkpointer->page_size);
+    uint8_t* buffer = checkpointer->staging_memory;
+
+    HANDLE rebase_file = CreateFileA(checkpointer->rebase_filename, GENERIC_WRITE, 0, 0, CREATE_ALWAYS, 0, 0);
+
+    if(rebase_file == INVALID_HANDLE_VALUE ||
+            !VirtualAlloc(checkpointer->staging_memory, buffer_capacity, MEM_COMMIT, PAGE_READWRITE)) {
+        Win32Log("Couldn't start rebasing checkpoints into %s\n", checkpointer->rebase_filename);
+
+        if(rebase_file != INVALID_HANDLE_VALUE) {
+            CloseHandle(rebase_file);
+            DeleteFileA(checkpointer->rebase_filename);
+        }
+
+        return false;
+    }
+
+    Win32CheckpointFileHeader* file_header = reinterpret_cast<Win32CheckpointFileHeader*>(buffer);
+    file_header->magic = WIN32_CHECKPOINT_FILE_MAGIC;
+    file_header->page_size = checkpointer->page_size;
+    file_header->memory_size = checkpointer->memory_size;
+
+    Win32CheckpointRecordHeader* record_header =
+        reinterpret_cast<Win32CheckpointRecordHeader*>(buffer + sizeof(Win32CheckpointFileHeader));
+    record_header->magic = WIN32_CHECKPOINT_RECORD_MAGIC;
+    record_header->sequence = checkpointer->sequence;
+    record_header->page_count = checkpointer->saved_page_count;
+    record_header->body_size = 0;
+
+    for(uint64_t page_index = 0; page_index < checkpointer->page_count; ++page_index) {
+        Win32CheckpointPageLocation* location = &checkpointer->page_locations[page_index];
+
+        if(location->offset) {
+            record_header->body_size += sizeof(Win32CheckpointPageHeader) + location->compressed_size;
+        }
+    }
+
+    uint64_t record_size = sizeof(Win32CheckpointRecordHeader) + record_header->body_size;
+    uint64_t buffer_size = sizeof(Win32CheckpointFileHeader) + sizeof(Win32CheckpointRecordHeader);
+    bool32 is_written = true;
+
+    // Note: In page order, so the new offsets follow from the sizes alone, and the old ones stay
+    // valid until the new file has replaced the old one
+    for(uint64_t page_index = 0; page_index < checkpointer->page_count && is_written; ++page_index) {
+        Win32CheckpointPageLocation* location = &checkpointer->page_locations[page_index];
+
+        if(!location->offset) {
+            continue;
+        }
+
+        if(buffer_size + sizeof(Win32CheckpointPageHeader) + location->compressed_size > buffer_capacity) {
+            is_written = Win32WriteEntireBuffer(rebase_file, buffer, buffer_size);
+            buffer_size = 0;
+        }
+
+        Win32CheckpointPageHeader* page_header = reinterpret_cast<Win32CheckpointPageHeader*>(buffer + buffer_size);
+        page_header->page_index = static_cast<uint32_t>(page_index);
+        page_header->compressed_size = location->compressed_size;
+        buffer_size += sizeof(Win32CheckpointPageHeader);
+
+        is_written = is_written &&
+            Win32SeekFile(checkpointer->file, location->offset) &&
+            Win32ReadEntireBuffer(checkpointer->file, buffer + buffer_size, location->compressed_size);
+        buffer_size += location->compressed_size;
+    }
+
+    is_written = is_written &&
+        Win32WriteEntireBuffer(rebase_file, buffer, buffer_size) &&
+        FlushFileBuffers(rebase_file);
+    CloseHandle(rebase_file);
+
+    bool32 result = false;
+
+    if(is_written) {
+        // Note: The move can't replace a file that's open, and there's no sharing it with the handle
+        CloseHandle(checkpointer->file);
+
+        result = MoveFileExA(
+            checkpointer->rebase_filename, checkpointer->filename, MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH);
+
+        checkpointer->file = CreateFileA(
+            checkpointer->filename, GENERIC_READ | GENERIC_WRITE, 0, 0, OPEN_EXISTING, 0, 0);
+
+        if(checkpointer->file == INVALID_HANDLE_VALUE) {
+            Win32Log(
+                "Couldn't reopen checkpoint file %s, no more checkpoints will be written\n", checkpointer->filename);
+            result = false;
+        }
+    }
+
+    if(!result) {
+        Win32Log("Couldn't rebase checkpoints, carrying on with the file as it was\n");
+        DeleteFileA(checkpointer->rebase_filename);
+        Win32SeekFile(checkpointer->file, checkpointer->file_size);
+
+        return false;
+    }
+
+    uint64_t offset = sizeof(Win32CheckpointFileHeader) + sizeof(Win32CheckpointRecordHeader);
+
+    for(uint64_t page_index = 0; page_index < checkpointer->page_count; ++page_index) {
+        Win32CheckpointPageLocation* location = &checkpointer->page_locations[page_index];
+
+        if(location->offset) {
+            location->offset = offset + sizeof(Win32CheckpointPageHeader);
+            offset = location->offset + location->compressed_size;
+        }
+    }
+
+    uint64_t old_file_size = checkpointer->file_size;
+    checkpointer->file_size = sizeof(Win32CheckpointFileHeader) + record_size;
+    checkpointer->full_record_size = record_size;
+    checkpointer->delta_records_size = 0;
+
+    Assert(offset == checkpointer->file_size);
+    Win32SeekFile(checkpointer->file, checkpointer->file_size);
+
+    Win32Log(
+        "Rebased checkpoints: %llu pages, %.1f MB down to %.1f MB in %.3fms\n",
+        checkpointer->saved_page_count, static_cast<double>(old_file_size) / (1024.0 * 1024.0),
+        static_cast<double>(checkpointer->file_size) / (1024.0 * 1024.0),
+        1000.0 * Win32GetSecondsElapsed(rebase_start, Win32GetWallClock()));
+
+    return true;
+}
+
+// Note: Runs on the worker thread, compressing the staged pages and appending them as one record
+internal void Win32WriteCheckpoint(Win32Checkpointer* checkpointer) {
+    LARGE_INTEGER write_start = Win32GetWallClock();
+
+    uint8_t* out = checkpointer->output_memory;
+    Win32CheckpointRecordHeader* record_header = reinterpret_cast<Win32CheckpointRecordHeader*>(out);
+    out += sizeof(Win32CheckpointRecordHeader);
+
+    for(uint64_t dirty_index = 0; dirty_index < checkpointer->dirty_page_count; ++dirty_index) {
+        uint8_t* page = checkpointer->staging_memory + dirty_index * checkpointer->page_size;
+        uint8_t* original_page = static_cast<uint8_t*>(checkpointer->dirty_pages[dirty_index]);
+
+        Win32CheckpointPageHeader* page_header = reinterpret_cast<Win32CheckpointPageHeader*>(out);
+        out += sizeof(Win32CheckpointPageHeader);
+
+        page_header->page_index = static_cast<uint32_t>(
+            (original_page - checkpointer->memory_block) / checkpointer->page_size);
+        page_header->compressed_size = LzCompress(page, checkpointer->page_size, out);
+
+        if(page_header->compressed_size >= checkpointer->page_size) {
+            CopyMemory(out, page, checkpointer->page_size);
+            page_header->compressed_size = checkpointer->page_size;
+        }
+
+        out += page_header->compressed_size;
+    }
+
+    record_header->magic = WIN32_CHECKPOINT_RECORD_MAGIC;
+    record_header->sequence = checkpointer->sequence;
+    record_header->page_count = checkpointer->dirty_page_count;
+    record_header->body_size = (out - checkpointer->output_memory) - sizeof(Win32CheckpointRecordHeader);
+
+    uint64_t record_size = out - checkpointer->output_memory;
+
+    if(!Win32WriteEntireBuffer(checkpointer->file, checkpointer->output_memory, record_size)) {
+        Win32Log("Couldn't write checkpoint %u, its pages go into the next one\n", checkpointer->sequence);
+
+        // Note: Cut off whatever part of the record did get written, so the file still ends on a whole record
+        Win32SeekFile(checkpointer->file, checkpointer->file_size);
+        SetEndOfFile(checkpointer->file);
+
+        for(uint64_t dirty_index = 0; dirty_index < checkpointer->dirty_page_count; ++dirty_index) {
+            uint64_t page_index = static_cast<uint64_t>(
+                static_cast<uint8_t*>(checkpointer->dirty_pages[dirty_index]) - checkpointer->memory_block) /
+                checkpointer->page_size;
+
+            if(!checkpointer->unsaved_pages[page_index]) {
+                checkpointer->unsaved_pages[page_index] = true;
+                ++checkpointer->unsaved_page_count;
+            }
+        }
+
+        return;
+    }
+
+    Win32LocateCheckpointPages(
+        checkpointer, checkpointer->file_size, checkpointer->output_memory + sizeof(Win32CheckpointRecordHeader),
+        checkpointer->dirty_page_count);
+
+    if(checkpointer->file_size == sizeof(Win32CheckpointFileHeader)) {
+        checkpointer->full_record_size = record_size;
+    } else {
+        checkpointer->delta_records_size += record_size;
+    }
+
+    checkpointer->file_size += record_size;
+
+    float32 write_seconds = Win32GetSecondsElapsed(write_start, Win32GetWallClock());
+    double staged_megabytes =
+        static_cast<double>(checkpointer->dirty_page_count * checkpointer->page_size) / (1024.0 * 1024.0);
+
+    Win32Log(
+        "Checkpoint %u: %llu pages (%.1f MB), main thread paused %.3fms, "
+        "wrote %.1f MB in %.3fms (%.1f MB/s)\n",
+        checkpointer->sequence, checkpointer->dirty_page_count, staged_megabytes,
+        1000.0 * checkpointer->pause_seconds, static_cast<double>(record_size) / (1024.0 * 1024.0),
+        1000.0 * write_seconds, staged_megabytes / write_seconds);
+
+    uint64_t rebase_size = checkpointer->full_record_size > WIN32_CHECKPOINT_MIN_REBASE_SIZE ?
+        checkpointer->full_record_size : WIN32_CHECKPOINT_MIN_REBASE_SIZE;
+
+    if(checkpointer->delta_records_size > rebase_size) {
+        Win32RebaseCheckpointFile(checkpointer);
+    }
+}
+
+internal DWORD WINAPI Win32CheckpointThreadProc(LPVOID parameter) {
+    Win32Checkpointer* checkpointer = static_cast<Win32Checkpointer*>(parameter);
+
+    for(;;) {
+        WaitForSingleObject(checkpointer->work_ready_event, INFINITE);
+
+        if(checkpointer->is_shutting_down) {
+            break;
+        }
+
+        Win32WriteCheckpoint(checkpointer);
+
+        if(checkpointer->dirty_page_count > WIN32_CHECKPOINT_RETAINED_PAGES) {
+            Win32TrimCheckpointMemory(checkpointer);
+        }
+
+        SetEvent(checkpointer->work_done_event);
+    }
+
+    return 0;
+}
+
+// Note: Picks up a file left by an earlier session, pointing every page at its latest data. Returns
+// false if the file isn't one this memory block's checkpoints can go in.
+internal bool32 Win32ResumeCheckpointFile(Win32Checkpointer* checkpointer) {
+    LARGE_INTEGER existing_file_size;
+    Win32CheckpointFileHeader file_header;
+
+    if(!GetFileSizeEx(checkpointer->file, &existing_file_size) ||
+            !Win32ReadEntireBuffer(checkpointer->file, &file_header, sizeof(file_header)) ||
+            file_header.magic != WIN32_CHECKPOINT_FILE_MAGIC ||
+            file_header.page_size != checkpointer->page_size ||
+            file_header.memory_size != checkpointer->memory_size) {
+        return false;
+    }
+
+    checkpointer->file_size = sizeof(file_header);
+
+    uint32_t record_count = 0;
+    Win32CheckpointRecordHeader record_header;
+
+    while(checkpointer->file_size < static_cast<uint64_t>(existing_file_size.QuadPart) &&
+            Win32ReadCheckpointRecord(checkpointer, &record_header)) {
+        Win32LocateCheckpointPages(
+            checkpointer, checkpointer->file_size, checkpointer->output_memory, record_header.page_count);
+
+        uint64_t record_size = sizeof(record_header) + record_header.body_size;
+
+        if(record_count++ == 0) {
+            checkpointer->full_record_size = record_size;
+        } else {
+            checkpointer->delta_records_size += record_size;
+        }
+
+        checkpointer->file_size += record_size;
+        checkpointer->sequence = record_header.sequence;
+    }
+
+    if(checkpointer->file_size < static_cast<uint64_t>(existing_file_size.QuadPart)) {
+        // Note: Most likely the last record was torn by a crash. Nothing past it could be restored
+        // anyway, and new records have to follow on from a whole one.
+        Win32Log(
+            "Checkpoint file %s is damaged after %u records, dropping the rest\n",
+            checkpointer->filename, record_count);
+        Win32SeekFile(checkpointer->file, checkpointer->file_size);
+        SetEndOfFile(checkpointer->file);
+    }
+
+    Win32SeekFile(checkpointer->file, checkpointer->file_size);
+    Win32TrimCheckpointMemory(checkpointer);
+
+    Win32Log(
+        "Resuming checkpoints in %s: %u records, %llu pages\n",
+        checkpointer->filename, record_count, checkpointer->saved_page_count);
+
+    return true;
+}
+
+internal void Win32FreeCheckpointer(Win32Checkpointer* checkpointer) {
+    if(checkpointer->file != INVALID_HANDLE_VALUE) {
+        CloseHandle(checkpointer->file);
+    }
+
+    VirtualFree(checkpointer->dirty_pages, 0, MEM_RELEASE);
+    VirtualFree(checkpointer->staging_memory, 0, MEM_RELEASE);
+    VirtualFree(checkpointer->output_memory, 0, MEM_RELEASE);
+    VirtualFree(checkpointer->page_locations, 0, MEM_RELEASE);
+    VirtualFree(checkpointer->unsaved_pages, 0, MEM_RELEASE);
+    *checkpointer = {};
+}
+
+// Note: memory_block must have been allocated with MEM_WRITE_WATCH. Unless resuming (and the file
+// turns out to fit memory_block), any existing file is started over.
+internal bool32 Win32BeginCheckpointer(
+        Win32Checkpointer* checkpointer, char* filename, void* memory_block, uint64_t memory_size,
+        PlatformMemoryStats* memory_stats, bool32 is_resuming) {
+    *checkpointer = {};
+
+    SYSTEM_INFO system_info;
+    GetSystemInfo(&system_info);
+
+    checkpointer->memory_block = static_cast<uint8_t*>(memory_block);
+    checkpointer->memory_size = memory_size;
+    checkpointer->page_size = system_info.dwPageSize;
+    checkpointer->page_count = (memory_size + checkpointer->page_size - 1) / checkpointer->page_size;
+    checkpointer->memory_stats = memory_stats;
+
+    Assert(checkpointer->page_size <= LZ_MAX_SOURCE_SIZE);
+
+    checkpointer->dirty_pages = static_cast<void**>(VirtualAlloc(
+        0, checkpointer->page_count * sizeof(void*), MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE));
+    checkpointer->staging_memory = static_cast<uint8_t*>(VirtualAlloc(
+        0, checkpointer->page_count * checkpointer->page_size, MEM_RESERVE, PAGE_READWRITE));
+    checkpointer->output_memory = static_cast<uint8_t*>(VirtualAlloc(
+        0, Win32GetCheckpointRecordMaxSize(checkpointer, checkpointer->page_count), MEM_RESERVE, PAGE_READWRITE));
+    checkpointer->page_locations = static_cast<Win32CheckpointPageLocation*>(VirtualAlloc(
+        0, checkpointer->page_count * sizeof(Win32CheckpointPageLocation), MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE));
+    checkpointer->unsaved_pages = static_cast<uint8_t*>(VirtualAlloc(
+        0, checkpointer->page_count, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE));
+
+    checkpointer->file = INVALID_HANDLE_VALUE;
+    int filename_length = GetStringLength_(filename);
+    char rebase_extension[] = ".tmp";
+
+    if(filename_length + sizeof(rebase_extension) <= sizeof(checkpointer->filename)) {
+        ConcatStrings_(filename_length, filename, 0, "", sizeof(checkpointer->filename), checkpointer->filename);
+        ConcatStrings_(
+            filename_length, filename, sizeof(rebase_extension) - 1, rebase_extension,
+            sizeof(checkpointer->rebase_filename), checkpointer->rebase_filename);
+
+        checkpointer->file = CreateFileA(
+            filename, GENERIC_READ | GENERIC_WRITE, 0, 0, is_resuming ? OPEN_ALWAYS : CREATE_ALWAYS, 0, 0);
+    }
+
+    if(!checkpointer->dirty_pages || !checkpointer->staging_memory || !checkpointer->output_memory ||
+            !checkpointer->page_locations || !checkpointer->unsaved_pages ||
+            checkpointer->file == INVALID_HANDLE_VALUE) {
+        Win32Log("Couldn't set up checkpoints for %llu bytes of memory in %s\n", memory_size, filename);
+        Win32FreeCheckpointer(checkpointer);
+
+        return false;
+    }
+
+    if(!is_resuming || !Win32ResumeCheckpointFile(checkpointer)) {
+        if(is_resuming) {
+            Win32Log("Nothing to resume in %s, starting a new checkpoint file\n", filename);
+        }
+
+        Win32CheckpointFileHeader header = {};
+        header.magic = WIN32_CHECKPOINT_FILE_MAGIC;
+        header.page_size = checkpointer->page_size;
+        header.memory_size = memory_size;
+
+        if(!Win32SeekFile(checkpointer->file, 0) || !SetEndOfFile(checkpointer->file) ||
+                !Win32WriteEntireBuffer(checkpointer->file, &header, sizeof(header))) {
+            Win32Log("Couldn't write checkpoint file %s\n", filename);
+            Win32FreeCheckpointer(checkpointer);
+
+            return false;
+        }
+
+        checkpointer->file_size = sizeof(header);
+    }
+
+    checkpointer->work_ready_event = CreateEventA(0, FALSE, FALSE, 0);
+    checkpointer->work_done_event = CreateEventA(0, TRUE, TRUE, 0);
+    checkpointer->worker_thread = CreateThread(0, 0, Win32CheckpointThreadProc, checkpointer, 0, 0);
+
+    return true;
+}
+
+internal void Win32EndCheckpointer(Win32Checkpointer* checkpointer) {
+    if(!checkpointer->worker_thread) {
+        return;
+    }
+
+    WaitForSingleObject(checkpointer->work_done_event, INFINITE);
+    checkpointer->is_shutting_down = true;
+    SetEvent(checkpointer->work_ready_event);
+    WaitForSingleObject(checkpointer->worker_thread, INFINITE);
+
+    CloseHandle(checkpointer->worker_thread);
+    CloseHandle(checkpointer->work_ready_event);
+    CloseHandle(checkpointer->work_done_event);
+
+    Win32FreeCheckpointer(checkpointer);
+}
+
+// Note: Only pauses the main thread long enough to copy out the pages written since the last
+// checkpoint, compression and file I/O happen on the worker. Returns false if the worker is still busy
+// with the previous checkpoint (which may be rebasing the file), in which case the dirty pages carry
+// over to the next attempt.
+internal bool32 Win32BeginCheckpoint(Win32Checkpointer* checkpointer) {
+    if(!checkpointer->worker_thread || WaitForSingleObject(checkpointer->work_done_event, 0) != WAIT_OBJECT_0 ||
+            checkpointer->file == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+
+    LARGE_INTEGER pause_start = Win32GetWallClock();
+
+    ULONG_PTR dirty_page_count = checkpointer->page_count;
+    DWORD granularity;
+
+    if(GetWriteWatch(
+            0, checkpointer->memory_block, checkpointer->memory_size,
+            checkpointer->dirty_pages, &dirty_page_count, &granularity) != 0) {
+        return false;
+    }
+
+    if(dirty_page_count == 0 && checkpointer->unsaved_page_count == 0) {
+        return true;
+    }
+
+    uint64_t staged_page_count = dirty_page_count + checkpointer->unsaved_page_count;
+    if(staged_page_count > checkpointer->page_count) {
+        staged_page_count = checkpointer->page_count;
+    }
+
+    // Note: Commit before resetting the watch, so running out of memory doesn't lose track of pages
+    if(!VirtualAlloc(
+            checkpointer->staging_memory, staged_page_count * checkpointer->page_size, MEM_COMMIT, PAGE_READWRITE) ||
+            !VirtualAlloc(
+                checkpointer->output_memory, Win32GetCheckpointRecordMaxSize(checkpointer, staged_page_count),
+                MEM_COMMIT, PAGE_READWRITE)) {
+        Win32Log("Couldn't commit memory for a %llu page checkpoint\n", staged_page_count);
+        return false;
+    }
+
+    Win32RecordWrittenPages(
+        checkpointer->memory_stats, checkpointer->memory_block, checkpointer->dirty_pages, dirty_page_count);
+
+    staged_page_count = dirty_page_count;
+
+    if(checkpointer->unsaved_page_count) {
+        // Note: Only after a failed write. The pages that are dirty again are staged anyway, the rest
+        // are added on.
+        for(ULONG_PTR dirty_index = 0; dirty_index < dirty_page_count; ++dirty_index) {
+            uint64_t page_index = static_cast<uint64_t>(
+                static_cast<uint8_t*>(checkpointer->dirty_pages[dirty_index]) - checkpointer->memory_block) /
+                checkpointer->page_size;
+            checkpointer->unsaved_pages[page_index] = false;
+        }
+
+        for(uint64_t page_index = 0; page_index < checkpointer->page_count; ++page_index) {
+            if(checkpointer->unsaved_pages[page_index]) {
+                checkpointer->unsaved_pages[page_index] = false;
+                checkpointer->dirty_pages[staged_page_count++] =
+                    checkpointer->memory_block + page_index * checkpointer->page_size;
+            }
+        }
+
+        checkpointer->unsaved_page_count = 0;
+    }
+
+    for(uint64_t staged_index = 0; staged_index < staged_page_count; ++staged_index) {
+        CopyMemory(
+            checkpointer->staging_memory + staged_index * checkpointer->page_size,
+            checkpointer->dirty_pages[staged_index], checkpointer->page_size);
+    }
+
+    ResetWriteWatch(checkpointer->memory_block, checkpointer->memory_size);
+
+    checkpointer->dirty_page_count = staged_page_count;
+    ++checkpointer->sequence;
+    checkpointer->pause_seconds = Win32GetSecondsElapsed(pause_start, Win32GetWallClock());
+
+    ResetEvent(checkpointer->work_done_event);
+    SetEvent(checkpointer->work_ready_event);
+
+    return true;
+}
+
+// Note: Brings the memory block back to the state of the most recent checkpoint, decompressing each
+// page straight into place
+internal bool32 Win32RestoreCheckpoint(Win32Checkpointer* checkpointer) {
+    if(!checkpointer->worker_thread) {
+        return false;
+    }
+
+    WaitForSingleObject(checkpointer->work_done_event, INFINITE);
+
+    if(checkpointer->file == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+
+    LARGE_INTEGER restore_start = Win32GetWallClock();
+
+    // Note: Pages first written after the last checkpoint aren't in any record, and have to go back
+    // to being zero. Pages that are in a record get overwritten below anyway.
+    ULONG_PTR dirty_page_count = checkpointer->page_count;
+    DWORD granularity;
+    GetWriteWatch(
+        0, checkpointer->memory_block, checkpointer->memory_size,
+        checkpointer->dirty_pages, &dirty_page_count, &granularity);
+
+    for(ULONG_PTR dirty_index = 0; dirty_index < dirty_page_count; ++dirty_index) {
+        ZeroMemory(checkpointer->dirty_pages[dirty_index], checkpointer->page_size);
+    }
+
+    // Note: The game still wrote these pages, even though the writes are being thrown away
+    Win32RecordWrittenPages(
+        checkpointer->memory_stats, checkpointer->memory_block, checkpointer->dirty_pages, dirty_page_count);
+
+    // Note: Same for pages whose last write failed, they were written after the last checkpoint that
+    // did make it into the file
+    if(checkpointer->unsaved_page_count) {
+        for(uint64_t page_index = 0; page_index < checkpointer->page_count; ++page_index) {
+            if(checkpointer->unsaved_pages[page_index]) {
+                checkpointer->unsaved_pages[page_index] = false;
+                ZeroMemory(checkpointer->memory_block + page_index * checkpointer->page_size, checkpointer->page_size);
+            }
+        }
+
+        checkpointer->unsaved_page_count = 0;
+    }
+
+    uint64_t record_offset = sizeof(Win32CheckpointFileHeader);
+    Win32SeekFile(checkpointer->file, record_offset);
+
+    bool32 result = true;
+    uint32_t record_count = 0;
+    Win32CheckpointRecordHeader record_header;
+
+    while(result && record_offset < checkpointer->file_size) {
+        if(!Win32ReadCheckpointRecord(checkpointer, &record_header)) {
+            result = false;
+            break;
+        }
+
+        uint8_t* at = checkpointer->output_memory;
+
+        for(uint64_t page_index = 0; page_index < record_header.page_count; ++page_index) {
+            Win32CheckpointPageHeader* page_header = reinterpret_cast<Win32CheckpointPageHeader*>(at);
+            at += sizeof(Win32CheckpointPageHeader);
+
+            uint8_t* page =
+                checkpointer->memory_block + static_cast<uint64_t>(page_header->page_index) * checkpointer->page_size;
+
+            if(page_header->compressed_size == checkpointer->page_size) {
+                CopyMemory(page, at, checkpointer->page_size);
+            } else if(!LzDecompress(at, page_header->compressed_size, page, checkpointer->page_size)) {
+                result = false;
+                break;
+            }
+
+            at += page_header->compressed_size;
+        }
+
+        if(result) {
+            record_offset += sizeof(record_header) + record_header.body_size;
+            ++record_count;
+        }
+    }
+
+    // Note: The block now matches the last checkpoint, so the next one only needs what changes after this
+    ResetWriteWatch(checkpointer->memory_block, checkpointer->memory_size);
+
+    // Note: Restoring commits output memory for the biggest record in the file
+    Win32TrimCheckpointMemory(checkpointer);
+
+    Win32SeekFile(checkpointer->file, checkpointer->file_size);
+
+    if(result) {
+        Win32Log(
+            "Restored %u checkpoint records in %.3fms\n",
+            record_count, 1000.0 * Win32GetSecondsElapsed(restore_start, Win32GetWallClock()));
+    } else {
+        Win32Log("Checkpoint file is damaged, restored %u records before the damage\n", record_count);
+    }
+
+    return result;
+}
+
+// Note: Which deque the current thread owns. The main thread owns deque 0 of every queue.
+global_variable __declspec(thread) int t_work_deque_index;
+global_variable __declspec(thread) uint32_t t_steal_random_state;
+
+internal bool32 Win32PushWork(Win32WorkDeque* deque, Win32WorkEntry* entry) {
+    int64_t bottom = deque->bottom;
+    int64_t top = deque->top;
+
+    if(bottom - top >= WIN32_WORK_DEQUE_SIZE) {
+        return false;
+    }
+
+    deque->entries[bottom & (WIN32_WORK_DEQUE_SIZE - 1)] = *entry;
+
+    // Note: Volatile store, so the entry is visible before the new bottom is
+    deque->bottom = bottom + 1;
+
+    return true;
+}
+
+internal bool32 Win32PopWork(Win32WorkDeque* deque, Win32WorkEntry* entry) {
+    int64_t bottom = deque->bottom - 1;
+    deque->bottom = bottom;
+    MemoryBarrier();
+    int64_t top = deque->top;
+
+    bool32 result = false;
+
+    if(top <= bottom) {
+        *entry = deque->entries[bottom & (WIN32_WORK_DEQUE_SIZE - 1)];
+        result = true;
+
+        if(top == bottom) {
+            // Note: Last entry, so race any thieves for it
+            if(InterlockedCompareExchange64(&deque->top, top + 1, top) != top) {
+                result = false;
+            }
+
+            deque->bottom = bottom + 1;
+        }
+    } else {
+        deque->bottom = bottom + 1;
+    }
+
+    return result;
+}
+
+internal bool32 Win32StealWork(Win32WorkDeque* deque, Win32WorkEntry* entry) {
+    for(;;) {
+        int64_t top = deque->top;
+        MemoryBarrier();
+        int64_t bottom = deque->bottom;
+
+        if(top >= bottom) {
+            return false;
+        }
+
+        *entry = deque->entries[top & (WIN32_WORK_DEQUE_SIZE - 1)];
+
+        // Note: Losing the race means someone else made progress, so try again
+        if(InterlockedCompareExchange64(&deque->top, top + 1, top) == top) {
+            return true;
+        }
+    }
+}
+
+internal bool32 Win32TakeWork(PlatformWorkQueue* queue, int deque_index, Win32WorkEntry* entry) {
+    if(Win32PopWork(&queue->deques[deque_index], entry)) {
+        return true;
+    }
+
+    // Note: Start at a random victim so idle workers don't all pile onto the same deque
+    t_steal_random_state = t_steal_random_state * 1664525 + 1013904223;
+    int first_victim = (t_steal_random_state >> 16) % queue->deque_count;
+
+    for(int victim_offset = 0; victim_offset < queue->deque_count; ++victim_offset) {
+        int victim = (first_victim + victim_offset) % queue->deque_count;
+
+        if(victim != deque_index && Win32StealWork(&queue->deques[victim], entry)) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+inline void Win32RunWork(PlatformWorkQueue* queue, Win32WorkEntry* entry) {
+    entry->callback(queue, entry->data);
+    InterlockedIncrement(&queue->completion_count);
+}
+
+internal void Win32WakeWorker(PlatformWorkQueue* queue) {
+    // Note: Pairs with the increment in Win32WorkerThreadProc. Either the worker sees the new work
+    // when it looks one last time before parking, or this sees the worker and wakes it.
+    MemoryBarrier();
+
+    for(;;) {
+        LONG sleeping_worker_count = queue->sleeping_worker_count;
+
+        if(sleeping_worker_count == 0) {
+            break;
+        }
+
+        if(InterlockedCompareExchange(
+                &queue->sleeping_worker_count, sleeping_worker_count - 1, sleeping_worker_count) ==
+                sleeping_worker_count) {
+            ReleaseSemaphore(queue->wake_semaphore, 1, 0);
+            break;
+        }
+    }
+}
+
+internal void Win32AddWork(PlatformWorkQueue* queue, PlatformWorkQueueCallback* callback, void* data) {
+    int deque_index = t_work_deque_index;
+    Assert(deque_index < queue->deque_count);
+    Assert(deque_index != 0 || GetCurrentThreadId() == queue->main_thread_id);
+
+    Win32WorkEntry entry = { callback, data };
+    InterlockedIncrement(&queue->completion_goal);
+
+    if(Win32PushWork(&queue->deques[deque_index], &entry)) {
+        Win32WakeWorker(queue);
+    } else {
+        // Note: Our deque is full, so there's plenty for everyone else to steal. Just do this one now.
+        Win32RunWork(queue, &entry);
+    }
+}
+
+internal void Win32CompleteAllWork(PlatformWorkQueue* queue) {
+    Assert(GetCurrentThreadId() == queue->main_thread_id);
+
+    Win32WorkEntry entry;
+
+    while(queue->completion_count != queue->completion_goal) {
+        if(Win32TakeWork(queue, 0, &entry)) {
+            Win32RunWork(queue, &entry);
+        } else {
+            YieldProcessor();
+        }
+    }
+}
+
+struct Win32ParallelForJob {
+    PlatformParallelForCallback* callback;
+    void* data;
+    int32_t count;
+    int32_t batch_size;
+    LONG batch_count;
+
+    LONG volatile next_batch;
+    LONG volatile helpers_remaining;
+};
+
+internal void Win32RunParallelForBatches(Win32ParallelForJob* parallel_for) {
+    for(;;) {
+        LONG batch = InterlockedIncrement(&parallel_for->next_batch) - 1;
+
+        if(batch >= parallel_for->batch_count) {
+            break;
+        }
+
+        int32_t first_index = batch * parallel_for->batch_size;
+        int32_t one_past_last_index = first_index + parallel_for->batch_size;
+
+        if(one_past_last_index > parallel_for->count) {
+            one_past_last_index = parallel_for->count;
+        }
+
+        parallel_for->callback(parallel_for->data, first_index, one_past_last_index);
+    }
+}
+
+internal void Win32ParallelForHelper(PlatformWorkQueue* queue, void* data) {
+    Win32ParallelForJob* parallel_for = static_cast<Win32ParallelForJob*>(data);
+    Win32RunParallelForBatches(parallel_for);
+
+    // Note: parallel_for may be gone as soon as this lands
+    InterlockedDecrement(&parallel_for->helpers_remaining);
+}
+
+internal void Win32ParallelFor(
+        PlatformWorkQueue* queue, int32_t count, int32_t batch_size, PlatformParallelForCallback* callback,
+        void* data) {
+    if(batch_size < 1) {
+        batch_size = 1;
+    }
+
+    Win32ParallelForJob parallel_for = {};
+    parallel_for.callback = callback;
+    parallel_for.data = data;
+    parallel_for.count = count;
+    parallel_for.batch_size = batch_size;
+    parallel_for.batch_count = (count + batch_size - 1) / batch_size;
+
+    // Note: Helpers pull batches until there are none left, so one per other thread is plenty
+    LONG helper_count = parallel_for.batch_count - 1;
+
+    if(helper_count > queue->deque_count - 1) {
+        helper_count = queue->deque_count - 1;
+    }
+
+    parallel_for.helpers_remaining = helper_count > 0 ? helper_count : 0;
+
+    for(LONG helper_index = 0; helper_index < helper_count; ++helper_index) {
+        Win32AddWork(queue, Win32ParallelForHelper, &parallel_for);
+    }
+
+    Win32RunParallelForBatches(&parallel_for);
+
+    // Note: Helpers that haven't started yet still point at parallel_for, so wait them out, doing
+    // other work (most likely those very helpers, from the bottom of our own deque) in the meantime
+    Win32WorkEntry entry;
+
+    while(parallel_for.helpers_remaining > 0) {
+        if(Win32TakeWork(queue, t_work_deque_index, &entry)) {
+            Win32RunWork(queue, &entry);
+        } else {
+            YieldProcessor();
+        }
+    }
+}
+
+inline void Win32RunWorkerWork(Win32WorkerContext* context, Win32WorkEntry* entry) {
+    LARGE_INTEGER start = Win32GetWallClock();
+    Win32RunWork(context->queue, entry);
+    context->busy_ticks += Win32GetWallClock().QuadPart - start.QuadPart;
+}
+
+internal DWORD WINAPI Win32WorkerThreadProc(LPVOID parameter) {
+    Win32WorkerContext* context = static_cast<Win32WorkerContext*>(parameter);
+    PlatformWorkQueue* queue = context->queue;
+    int deque_index = context->deque_index;
+
+    t_work_deque_index = deque_index;
+    t_steal_random_state = deque_index * 2654435761u;
+
+    Win32WorkEntry entry;
+    int idle_spin_count = 0;
+
+    while(!queue->is_shutting_down) {
+        if(Win32TakeWork(queue, deque_index, &entry)) {
+            Win32RunWorkerWork(context, &entry);
+            idle_spin_count = 0;
+            continue;
+        }
+
+        if(++idle_spin_count < WIN32_WORKER_SPIN_COUNT) {
+            YieldProcessor();
+            continue;
+        }
+
+        idle_spin_count = 0;
+
+        InterlockedIncrement(&queue->sleeping_worker_count);
+
+        if(!queue->is_shutting_down && !Win32TakeWork(queue, deque_index, &entry)) {
+            WaitForSingleObject(queue->wake_semaphore, INFINITE);
+            continue;
+        }
+
+        // Note: Not parking after all, so take ourselves back off the sleeping count. If a waker
+        // already did that for us, it has also released (or is about to release) a unit for us.
+        for(;;) {
+            LONG sleeping_worker_count = queue->sleeping_worker_count;
+
+            if(sleeping_worker_count == 0) {
+                WaitForSingleObject(queue->wake_semaphore, INFINITE);
+                break;
+            }
+
+            if(InterlockedCompareExchange(
+                    &queue->sleeping_worker_count, sleeping_worker_count - 1, sleeping_worker_count) ==
+                    sleeping_worker_count) {
+                break;
+            }
+        }
+
+        if(!queue->is_shutting_down) {
+            Win32RunWorkerWork(context, &entry);
+        }
+    }
+
+    return 0;
+}
+
+internal void Win32BeginWorkQueue(PlatformWorkQueue* queue, int worker_count) {
+    Assert(worker_count <= WIN32_MAX_WORKER_COUNT);
+
+    *queue = {};
+    queue->deque_count = worker_count + 1;
+    queue->deques = static_cast<Win32WorkDeque*>(VirtualAlloc(
+        0, queue->deque_count * sizeof(Win32WorkDeque), MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE));
+    queue->wake_semaphore = CreateSemaphoreA(0, 0, 0x7FFFFFFF, 0);
+    queue->main_thread_id = GetCurrentThreadId();
+
+    // Note: The workers take the other processors, so the main thread doesn't get moved onto one of
+    // them and then compete with the worker pinned there
+    SetThreadAffinityMask(GetCurrentThread(), 1);
+
+    t_work_deque_index = 0;
+    t_steal_random_state = 1;
+
+    for(int worker_index = 0; worker_index < worker_count; ++worker_index) {
+        Win32WorkerContext* context = &queue->worker_contexts[worker_index];
+        context->queue = queue;
+        context->deque_index = worker_index + 1;
+
+        // Note: Pinned one per logical processor, leaving processor 0 to the main thread
+        queue->worker_threads[worker_index] = CreateThread(0, 0, Win32WorkerThreadProc, context, 0, 0);
+        SetThreadAffinityMask(queue->worker_threads[worker_index], static_cast<DWORD_PTR>(1) << (worker_index + 1));
+    }
+}
+
+internal void Win32EndWorkQueue(PlatformWorkQueue* queue) {
+    Win32CompleteAllWork(queue);
+
+    int worker_count = queue->deque_count - 1;
+    queue->is_shutting_down = true;
+    ReleaseSemaphore(queue->wake_semaphore, worker_count, 0);
+
+    for(int worker_index = 0; worker_index < worker_count; ++worker_index) {
+        WaitForSingleObject(queue->worker_threads[worker_index], INFINITE);
+        CloseHandle(queue->worker_threads[worker_index]);
+    }
+
+    CloseHandle(queue->wake_semaphore);
+    VirtualFree(queue->deques, 0, MEM_RELEASE);
+    *queue = {};
+}
+
+internal int Win32GetDefaultWorkerCount() {
+    SYSTEM_INFO system_info;
+    GetSystemInfo(&system_info);
+
+    int result = static_cast<int>(system_info.dwNumberOfProcessors) - 1;
+
+    if(result < 0) {
+        result = 0;
+    }
+
+    if(result > WIN32_MAX_WORKER_COUNT) {
+        result = WIN32_MAX_WORKER_COUNT;
+    }
+
+    return result;
+}
+
+internal void Win32UpdateFrameStats(
+        PlatformFrameStats* stats, PlatformWorkQueue* queue, LARGE_INTEGER frame_start, LARGE_INTEGER frame_end,
+        float32 update_seconds) {
+    float32 frame_seconds = Win32GetSecondsElapsed(frame_start, frame_end);
+    int64_t frame_ticks = frame_end.QuadPart - frame_start.QuadPart;
+
+    stats->frame_seconds[stats->frame_count++ % PLATFORM_FRAME_HISTORY_COUNT] = frame_seconds;
+
+    stats->thread_count = queue->deque_count;
+    if(stats->thread_count > PLATFORM_MAX_REPORTED_THREADS) {
+        stats->thread_count = PLATFORM_MAX_REPORTED_THREADS;
+    }
+
+    stats->thread_utilization[0] = frame_seconds > 0.0f ? update_seconds / frame_seconds : 0.0f;
+
+    for(int32_t thread_index = 1; thread_index < stats->thread_count; ++thread_index) {
+        Win32WorkerContext* context = &queue->worker_contexts[thread_index - 1];
+
+        int64_t busy_ticks = context->busy_ticks;
+        int64_t frame_busy_ticks = busy_ticks - context->sampled_busy_ticks;
+        context->sampled_busy_ticks = busy_ticks;
+
+        stats->thread_utilization[thread_index] = frame_ticks > 0 ?
+            static_cast<float32>(static_cast<double>(frame_busy_ticks) / static_cast<double>(frame_ticks)) : 0.0f;
+    }
+}
+
+inline void Win32GetResolutionForLevel(Win32ResolutionScaler* scaler, int level, int* width, int* height) {
+    float32 scale = 1.0f - level * WIN32_RESOLUTION_LEVEL_STEP;
+
+    // Note: Keep rows a multiple of 4 pixels wide, and the aspect ratio the same as full size
+    *width = static_cast<int>(scaler->max_width * scale) & ~3;
+    *height = *width * scaler->max_height / scaler->max_width;
+}
+
+internal void Win32FlushResolutionTrace(Win32ResolutionScaler* scaler) {
+    if(scaler->trace_file != INVALID_HANDLE_VALUE && scaler->trace_buffer_size > 0) {
+        DWORD bytes_written;
+        WriteFile(scaler->trace_file, scaler->trace_buffer, scaler->trace_buffer_size, &bytes_written, 0);
+    }
+
+    scaler->trace_buffer_size = 0;
+}
+
+internal void Win32BeginResolutionScaler(
+        Win32ResolutionScaler* scaler, Win32OffscreenBuffer* buffer, char* trace_filename) {
+    scaler->max_width = buffer->max_width;
+    scaler->max_height = buffer->max_height;
+    scaler->level = 0;
+    scaler->target_seconds = WIN32_RESOLUTION_TARGET_SECONDS;
+    scaler->sample_count = 0;
+    scaler->frame_index = 0;
+    scaler->trace_buffer_size = 0;
+
+    scaler->trace_file = CreateFileA(trace_filename, GENERIC_WRITE, FILE_SHARE_READ, 0, CREATE_ALWAYS, 0, 0);
+
+    if(scaler->trace_file == INVALID_HANDLE_VALUE) {
+        Win32Log("Couldn't create resolution trace %s\n", trace_filename);
+    } else {
+        char* trace_columns = "frame,render_ms,width,height\n";
+        DWORD bytes_written;
+        WriteFile(scaler->trace_file, trace_columns, GetStringLength_(trace_columns), &bytes_written, 0);
+    }
+}
+
+internal void Win32EndResolutionScaler(Win32ResolutionScaler* scaler) {
+    Win32FlushResolutionTrace(scaler);
+
+    if(scaler->trace_file != INVALID_HANDLE_VALUE) {
+        CloseHandle(scaler->trace_file);
+        scaler->trace_file = INVALID_HANDLE_VALUE;
+    }
+}
+
+// Note: Called once a frame with how long the game took to update and render. Picks the render
+// resolution for the next frame and applies it to the buffer.
+internal void Win32UpdateResolutionScaler(
+        Win32ResolutionScaler* scaler, Win32OffscreenBuffer* buffer, float32 render_seconds) {
+    if(scaler->trace_buffer_size > static_cast<int>(sizeof(scaler->trace_buffer)) - 64) {
+        Win32FlushResolutionTrace(scaler);
+    }
+
+    int trace_line_size = _snprintf_s(
+        scaler->trace_buffer + scaler->trace_buffer_size, sizeof(scaler->trace_buffer) - scaler->trace_buffer_size,
+        _TRUNCATE, "%u,%.3f,%d,%d\n", scaler->frame_index++, 1000.0 * render_seconds, buffer->width, buffer->height);
+
+    if(trace_line_size > 0) {
+        scaler->trace_buffer_size += trace_line_size;
+    }
+
+    scaler->render_seconds[scaler->sample_count++] = render_seconds;
+
+    if(scaler->sample_count < WIN32_RESOLUTION_WINDOW_FRAMES) {
+        return;
+    }
+
+    float32 average_seconds = 0.0f;
+
+    for(int sample_index = 0; sample_index < scaler->sample_count; ++sample_index) {
+        average_seconds += scaler->render_seconds[sample_index];
+    }
+
+    average_seconds /= scaler->sample_count;
+    scaler->sample_count = 0;
+
+    int width;
+    int height;
+    int new_level = scaler->level;
+
+    if(average_seconds > scaler->target_seconds) {
+        if(new_level < WIN32_RESOLUTION_LEVEL_COUNT - 1) {
+            ++new_level;
+        }
+    } else if(new_level > 0) {
+        // Note: Assume cost scales with pixel count to guess how the next level up would do
+        int larger_width;
+        int larger_height;
+        Win32GetResolutionForLevel(scaler, new_level - 1, &larger_width, &larger_height);
+
+        float32 area_ratio =
+            static_cast<float32>(larger_width * larger_height) / static_cast<float32>(buffer->width * buffer->height);
+
+        if(average_seconds * area_ratio < scaler->target_seconds * WIN32_RESOLUTION_RAISE_THRESHOLD) {
+            --new_level;
+        }
+    }
+
+    if(new_level != scaler->level) {
+        scaler->level = new_level;
+        Win32GetResolutionForLevel(scaler, new_level, &width, &height);
+        Win32SetBufferResolution(buffer, width, height);
+
+        Win32Log(
+            "Render resolution %dx%d, averaged %.3fms against a %.3fms target\n",
+            width, height, 1000.0 * average_seconds, 1000.0 * scaler->target_seconds);
+    }
+}
+
+enum Win32InputCommand {
+    Win32InputCommand_Quit,
+    Win32InputCommand_ToggleInputRecording,
+    Win32InputCommand_RestoreCheckpoint,
+};
+
+// Note: Only ever called from the message thread, which keeps g_input_events single-producer
+internal void Win32PostInputEvent(uint32_t type, uint32_t index, bool32 is_down) {
+    InputEvent event = {};
+    event.type = type;
+    event.index = index;
+    event.is_down = is_down;
+
+    // Note: A dropped release would leave a button held forever, so wait for the simulation thread to
+    // make room. Once it has stopped running nobody will, and the event no longer matters.
+    while(!PushInputEvent(&g_input_events, &event) && g_is_running) {
+        Sleep(1);
+    }
+}
+
+internal void Win32PostInputCommand(Win32InputCommand command) {
+    Win32PostInputEvent(InputEventType_Command, command, true);
+}
+
+internal bool32 Win32GetControllerButtonForKey(uint32_t vk_code, uint32_t* button_index) {
+    switch(vk_code) {
+        case 'W': {
+            *button_index = ControllerButtonIndex(move_up);
+            break;
+        }
+        case 'A': {
+            *button_index = ControllerButtonIndex(move_left);
+            break;
+        }
+        case 'S': {
+            *button_index = ControllerButtonIndex(move_down);
+            break;
+        }
+        case 'D': {
+            *button_index = ControllerButtonIndex(move_right);
+            break;
+        }
+        case 'Q': {
+            *button_index = ControllerButtonIndex(left_shoulder);
+            break;
+        }
+        case 'E': {
+            *button_index = ControllerButtonIndex(right_shoulder);
+            break;
+        }
+        case VK_UP: {
+            *button_index = ControllerButtonIndex(action_up);
+            break;
+        }
+        case VK_LEFT: {
+            *button_index = ControllerButtonIndex(action_left);
+            break;
+        }
+        case VK_DOWN: {
+            *button_index = ControllerButtonIndex(action_down);
+            break;
+        }
+        case VK_RIGHT: {
+            *button_index = ControllerButtonIndex(action_right);
+            break;
+        }
+        case VK_ESCAPE: {
+            *button_index = ControllerButtonIndex(back);
+            break;
+        }
+        case VK_SPACE: {
+            *button_index = ControllerButtonIndex(start);
+            break;
+        }
+        default: {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+internal void Win32ProcessMouseButtonMessage(HWND window, uint32_t button_index, bool32 is_down) {
+    // Note: Keep receiving messages while a button is held, so a release outside the window still
+    // arrives
+    if(is_down) {
+        SetCapture(window);
+    } else {
+        ReleaseCapture();
+    }
+
+    Win32PostInputEvent(InputEventType_MouseButton, button_index, is_down);
+}
+
+// Note: Runs on the message thread. Blocks until the thread is asked to quit.
+internal void Win32PumpMessages() {
+    MSG message;
+
+    while(GetMessageA(&message, 0, 0, 0) > 0) {
+        switch(message.message) {
+            case WM_SYSKEYDOWN:
+            case WM_SYSKEYUP:
+            case WM_KEYDOWN:
+            case WM_KEYUP: {
+                uint32_t vk_code = static_cast<uint32_t>(message.wParam);
+
+                bool32 was_down = (message.lParam & (1 << 30)) != 0;
+                bool32 is_down = (message.lParam & (1 << 31)) == 0;
+
+                if(was_down != is_down) {
+                    uint32_t button_index;
+
+                    if(Win32GetControllerButtonForKey(vk_code, &button_index)) {
+                        Win32PostInputEvent(InputEventType_ControllerButton, button_index, is_down);
+                    }
+
+                    if(is_down) {
+                        bool32 alt_key_is_down = message.lParam & (1 << 29);
+
+                        if(vk_code == VK_F4 && alt_key_is_down) {
+                            Win32PostInputCommand(Win32InputCommand_Quit);
+                        }
+
+                        if(vk_code == VK_RETURN && alt_key_is_down && message.hwnd) {
+                            Win32ToggleFullscreen(message.hwnd);
+                        }
+
+                        if(vk_code == VK_F9) {
+                            Win32PostInputCommand(Win32InputCommand_RestoreCheckpoint);
+                        }
+
+                        if(vk_code == 'L') {
+                            Win32PostInputCommand(Win32InputCommand_ToggleInputRecording);
+                        }
+                    }
+                }
+
+                break;
+            }
+
+            case WM_LBUTTONDOWN:
+            case WM_LBUTTONUP: {
+                Win32ProcessMouseButtonMessage(message.hwnd, 0, message.message == WM_LBUTTONDOWN);
+                break;
+            }
+
+            case WM_MBUTTONDOWN:
+            case WM_MBUTTONUP: {
+                Win32ProcessMouseButtonMessage(message.hwnd, 1, message.message == WM_MBUTTONDOWN);
+                break;
+            }
+
+            case WM_RBUTTONDOWN:
+            case WM_RBUTTONUP: {
+                Win32ProcessMouseButtonMessage(message.hwnd, 2, message.message == WM_RBUTTONDOWN);
+                break;
+            }
+
+            case WM_XBUTTONDOWN:
+            case WM_XBUTTONUP: {
+                uint32_t button_index = (GET_XBUTTON_WPARAM(message.wParam) == XBUTTON1) ? 3 : 4;
+                Win32ProcessMouseButtonMessage(message.hwnd, button_index, message.message == WM_XBUTTONDOWN);
+                break;
+            }
+
+            default: {
+                TranslateMessage(&message);
+                DispatchMessageA(&message);
+                break;
+            }
+        }
+    }
+
+    // Note: Covers GetMessage failing, as well as the quit posted on the way out of WM_DESTROY
+    Win32PostInputCommand(Win32InputCommand_Quit);
+}
+
+struct Win32MessageThreadStartup {
+    HINSTANCE instance;
+    LPCSTR window_class_name;
+    HANDLE window_created_event;
+    HWND window;
+};
+
+// Note: Owns the window. Windows delivers a window's messages to the thread that created it, and a
+// thread pumping them can be held up for as long as the user drags or resizes the window, so the
+// simulation thread never touches the pump.
+internal DWORD WINAPI Win32MessageThreadProc(LPVOID parameter) {
+    Win32MessageThreadStartup* startup = static_cast<Win32MessageThreadStartup*>(parameter);
+
+    HWND window = CreateWindowEx(
+        0, startup->window_class_name, "Nameless Watcher", WS_OVERLAPPEDWINDOW | WS_VISIBLE,
+        CW_USEDEFAULT, CW_USEDEFAULT, CW_USEDEFAULT, CW_USEDEFAULT, 0, 0, startup->instance, 0);
+
+    // Note: startup lives on the creating thread's stack, and can be gone as soon as this is signalled
+    startup->window = window;
+    SetEvent(startup->window_created_event);
+
+    if(window) {
+        Win32PumpMessages();
+    }
+
+    return 0;
+}
+
+internal void Win32ToggleInputRecording(Win32State* state) {
+    if(state->playback_handle) {
+        Win32EndInputPlayback(state);
+    } else if(state->recording_handle) {
+        Win32EndInputRecording(state);
+        Win32BeginInputPlayback(state);
+    } else {
+        Win32BeginInputRecording(state);
+    }
+}
+
+internal void Win32ProcessInputCommand(Win32State* state, uint32_t command) {
+    switch(command) {
+        case Win32InputCommand_Quit: {
+            g_is_running = false;
+            break;
+        }
+
+        case Win32InputCommand_ToggleInputRecording: {
+            Win32ToggleInputRecording(state);
+            break;
+        }
+
+        case Win32InputCommand_RestoreCheckpoint: {
+            Win32RestoreCheckpoint(&state->checkpointer);
+            break;
+        }
+    }
+}
+
+inline char* Win32SkipWhitespace(char* scan) {
+    while(*scan == ' ' || *scan == '\t') {
+        ++scan;
+    }
+
+    return scan;
+}
+
+// Note: On a match, returns true and points *arguments at whatever follows the switch
+internal bool32 Win32MatchCommandLineSwitch(char* command_line, char* switch_name, char** arguments) {
+    char* scan = Win32SkipWhitespace(command_line);
+
+    while(*switch_name) {
+        if(*scan++ != *switch_name++) {
+            return false;
+        }
+    }
+
+    if(*scan && *scan != ' ' && *scan != '\t') {
+        return false;
+    }
+
+    *arguments = Win32SkipWhitespace(scan);
+
+    return true;
+}
+
+// Note: Recognizes "-replay <trace file> [first frame]", the path may be quoted
+internal bool32 Win32ParseReplayCommandLine(
+        char* command_line, int trace_filename_count, char* trace_filename, uint32_t* first_frame_index) {
+    char* scan;
+
+    if(!Win32MatchCommandLineSwitch(command_line, "-replay", &scan)) {
+        return false;
+    }
+
+    char terminator = ' ';
+    if(*scan == '"') {
+        terminator = '"';
+        ++scan;
+    }
+
+    int filename_length = 0;
+    while(*scan && *scan != terminator && filename_length < trace_filename_count - 1) {
+        trace_filename[filename_length++] = *scan++;
+    }
+
+    trace_filename[filename_length] = 0;
+
+    if(*scan == '"') {
+        ++scan;
+    }
+
+    scan = Win32SkipWhitespace(scan);
+
+    *first_frame_index = 0;
+    while(*scan >= '0' && *scan <= '9') {
+        *first_frame_index = *first_frame_index * 10 + static_cast<uint32_t>(*scan++ - '0');
+    }
+
+    return filename_length > 0;
+}
+
+// Note: Runs a recorded trace through the game as fast as possible with no window, reporting trace
+// size and decode speed. Blocks are streamed from disk, so trace length doesn't affect memory use.
+internal int Win32ReplayInputTraceHeadless(
+        Win32GameCode* game, GameMemory* game_memory, char* trace_filename, uint32_t first_frame_index) {
+    if(!game->update_and_render) {
+        Win32Log("Couldn't load game code for replay\n");
+        return -1;
+    }
+
+    HANDLE file = Win32OpenInputTrace(trace_filename);
+
+    if(file == INVALID_HANDLE_VALUE) {
+        return -1;
+    }
+
+    void* payload_memory = VirtualAlloc(0, INPUT_TRACE_MAX_BLOCK_PAYLOAD_SIZE, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+    GameInput* inputs = static_cast<GameInput*>(VirtualAlloc(
+        0, INPUT_TRACE_FRAMES_PER_BLOCK * sizeof(GameInput), MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE));
+
+    InputTraceDecoder decoder;
+
+    if(!Win32SeekInputTrace(file, first_frame_index, &decoder, payload_memory)) {
+        Win32Log("Input trace %s has no frame %u\n", trace_filename, first_frame_index);
+        CloseHandle(file);
+        return -1;
+    }
+
+    GameOffscreenBuffer offscreen_buffer = {};
+    offscreen_buffer.memory = g_back_buffer.memory;
+    offscreen_buffer.width = g_back_buffer.width;
+    offscreen_buffer.height = g_back_buffer.height;
+    offscreen_buffer.pitch = g_back_buffer.pitch;
+    offscreen_buffer.bytes_per_pixel = g_back_buffer.bytes_per_pixel;
+
+    uint64_t frame_count = 0;
+    float32 decode_seconds = 0.0f;
+    float32 update_seconds = 0.0f;
+    bool32 is_trace_done = false;
+
+    while(!is_trace_done) {
+        LARGE_INTEGER decode_start = Win32GetWallClock();
+        uint32_t input_count = 0;
+
+        while(input_count < INPUT_TRACE_FRAMES_PER_BLOCK) {
+            if(InputTraceDecodeFrame(&decoder, &inputs[input_count])) {
+                ++input_count;
+            } else if(!Win32ReadInputTraceBlock(file, &decoder, payload_memory)) {
+                is_trace_done = true;
+                break;
+            }
+        }
+
+        LARGE_INTEGER update_start = Win32GetWallClock();
+
+        for(uint32_t input_index = 0; input_index < input_count; ++input_index) {
+            game->update_and_render(game_memory, &inputs[input_index], &offscreen_buffer);
+        }
+
+        LARGE_INTEGER update_end = Win32GetWallClock();
+
+        decode_seconds += Win32GetSecondsElapsed(decode_start, update_start);
+        update_seconds += Win32GetSecondsElapsed(update_start, update_end);
+        frame_count += input_count;
+    }
+
+    LARGE_INTEGER file_size;
+    GetFileSizeEx(file, &file_size);
+    CloseHandle(file);
+
+    uint64_t raw_size = frame_count * sizeof(GameInput);
+    Win32Log(
+        "Replayed %llu frames from %s, starting at frame %u\n", frame_count, trace_filename, first_frame_index);
+    Win32Log(
+        "Trace: %llu bytes, %llu bytes unpacked (%.1f:1)\n",
+        file_size.QuadPart, raw_size, static_cast<double>(raw_size) / static_cast<double>(file_size.QuadPart));
+    double frames = static_cast<double>(frame_count);
+    Win32Log(
+        "Decode: %.3fs, %.0f frames/s, %.1f MB/s unpacked\n",
+        decode_seconds, frames / decode_seconds, static_cast<double>(raw_size) / (decode_seconds * 1024.0 * 1024.0));
+    Win32Log(
+        "Update: %.3fs, %.4fms/frame\n",
+        update_seconds, frame_count ? 1000.0 * update_seconds / frames : 0.0);
+
+    return 0;
+}
+
+// Note: Fills pages the way game memory tends to look, a little noise amongst a lot of structure
+internal void Win32FillCheckpointBenchmarkPages(uint8_t* memory, uint64_t size, uint32_t page_size, uint32_t page_stride) {
+    local_persist uint32_t random_state = 0x2545F491;
+
+    for(uint64_t page_offset = 0; page_offset < size; page_offset += static_cast<uint64_t>(page_size) * page_stride) {
+        uint32_t* page = reinterpret_cast<uint32_t*>(memory + page_offset);
+
+        for(uint32_t word_index = 0; word_index < page_size / sizeof(uint32_t); ++word_index) {
+            random_state ^= random_state << 13;
+            random_state ^= random_state >> 17;
+            random_state ^= random_state << 5;
+
+            page[word_index] = (word_index % 8 == 0) ? random_state : word_index / 16;
+        }
+    }
+}
+
+// Note: Measures main thread pause and worker bandwidth for a full first checkpoint and an incremental
+// one at a range of memory sizes, then a restore. Sizes that can't be allocated are skipped.
+internal int Win32RunCheckpointBenchmark(char* checkpoint_filename) {
+    uint64_t memory_sizes[] = { Megabytes(256), Megabytes(512), Gigabytes(1), Gigabytes(2), Gigabytes(4) };
+    int memory_size_count = sizeof(memory_sizes) / sizeof(memory_sizes[0]);
+
+    for(int size_index = 0; size_index < memory_size_count; ++size_index) {
+        uint64_t memory_size = memory_sizes[size_index];
+        uint8_t* memory = static_cast<uint8_t*>(VirtualAlloc(
+            0, memory_size, MEM_RESERVE | MEM_COMMIT | MEM_WRITE_WATCH, PAGE_READWRITE));
+
+        Win32Log("-- %llu MB of game memory --\n", memory_size / Megabytes(1));
+
+        Win32Checkpointer checkpointer;
+
+        if(!memory || !Win32BeginCheckpointer(&checkpointer, checkpoint_filename, memory, memory_size, 0, false)) {
+            Win32Log("Skipped, couldn't allocate\n");
+            VirtualFree(memory, 0, MEM_RELEASE);
+            continue;
+        }
+
+        Win32FillCheckpointBenchmarkPages(memory, memory_size, checkpointer.page_size, 1);
+        Win32BeginCheckpoint(&checkpointer);
+        WaitForSingleObject(checkpointer.work_done_event, INFINITE);
+
+        Win32FillCheckpointBenchmarkPages(memory, memory_size, checkpointer.page_size, 16);
+        Win32BeginCheckpoint(&checkpointer);
+        WaitForSingleObject(checkpointer.work_done_event, INFINITE);
+
+        Win32FillCheckpointBenchmarkPages(memory, memory_size, checkpointer.page_size, 64);
+        Win32RestoreCheckpoint(&checkpointer);
+
+        Win32EndCheckpointer(&checkpointer);
+        VirtualFree(memory, 0, MEM_RELEASE);
+    }
+
+    DeleteFileA(checkpoint_filename);
+
+    return 0;
+}
+
+// Note: Baseline for the job benchmark, a single ring buffer behind a lock that every thread fights over
+struct Win32MutexWorkQueue {
+    CRITICAL_SECTION lock;
+    HANDLE wake_semaphore;
+    uint32_t read_index;
+    uint32_t write_index;
+    Win32WorkEntry entries[WIN32_WORK_DEQUE_SIZE];
+
+    LONG volatile completion_goal;
+    LONG volatile completion_count;
+    bool32 volatile is_shutting_down;
+
+    int worker_count;
+    HANDLE worker_threads[WIN32_MAX_WORKER_COUNT];
+};
+
+internal bool32 Win32TakeMutexWork(Win32MutexWorkQueue* queue, Win32WorkEntry* entry) {
+    bool32 result = false;
+
+    EnterCriticalSection(&queue->lock);
+
+    if(queue->read_index != queue->write_index) {
+        *entry = queue->entries[queue->read_index++ & (WIN32_WORK_DEQUE_SIZE - 1)];
+        result = true;
+    }
+
+    LeaveCriticalSection(&queue->lock);
+
+    return result;
+}
+
+internal void Win32AddMutexWork(Win32MutexWorkQueue* queue, PlatformWorkQueueCallback* callback, void* data) {
+    Win32WorkEntry entry = { callback, data };
+    InterlockedIncrement(&queue->completion_goal);
+
+    EnterCriticalSection(&queue->lock);
+    bool32 is_queued = queue->write_index - queue->read_index < WIN32_WORK_DEQUE_SIZE;
+
+    if(is_queued) {
+        queue->entries[queue->write_index++ & (WIN32_WORK_DEQUE_SIZE - 1)] = entry;
+    }
+
+    LeaveCriticalSection(&queue->lock);
+
+    if(is_queued) {
+        ReleaseSemaphore(queue->wake_semaphore, 1, 0);
+    } else {
+        entry.callback(0, entry.data);
+        InterlockedIncrement(&queue->completion_count);
+    }
+}
+
+internal void Win32CompleteAllMutexWork(Win32MutexWorkQueue* queue) {
+    Win32WorkEntry entry;
+
+    while(queue->completion_count != queue->completion_goal) {
+        if(Win32TakeMutexWork(queue, &entry)) {
+            entry.callback(0, entry.data);
+            InterlockedIncrement(&queue->completion_count);
+        } else {
+            YieldProcessor();
+        }
+    }
+}
+
+internal DWORD WINAPI Win32MutexWorkerThreadProc(LPVOID parameter) {
+    Win32MutexWorkQueue* queue = static_cast<Win32MutexWorkQueue*>(parameter);
+    Win32WorkEntry entry;
+
+    for(;;) {
+        WaitForSingleObject(queue->wake_semaphore, INFINITE);
+
+        if(queue->is_shutting_down) {
+            break;
+        }
+
+        if(Win32TakeMutexWork(queue, &entry)) {
+            entry.callback(0, entry.data);
+            InterlockedIncrement(&queue->completion_count);
+        }
+    }
+
+    return 0;
+}
+
+internal void Win32BeginMutexWorkQueue(Win32MutexWorkQueue* queue, int worker_count) {
+    InitializeCriticalSection(&queue->lock);
+    queue->wake_semaphore = CreateSemaphoreA(0, 0, 0x7FFFFFFF, 0);
+    queue->read_index = 0;
+    queue->write_index = 0;
+    queue->completion_goal = 0;
+    queue->completion_count = 0;
+    queue->is_shutting_down = false;
+    queue->worker_count = worker_count;
+
+    for(int worker_index = 0; worker_index < worker_count; ++worker_index) {
+        queue->worker_threads[worker_index] = CreateThread(0, 0, Win32MutexWorkerThreadProc, queue, 0, 0);
+    }
+}
+
+internal void Win32EndMutexWorkQueue(Win32MutexWorkQueue* queue) {
+    Win32CompleteAllMutexWork(queue);
+
+    queue->is_shutting_down = true;
+    ReleaseSemaphore(queue->wake_semaphore, queue->worker_count, 0);
+
+    for(int worker_index = 0; worker_index < queue->worker_count; ++worker_index) {
+        WaitForSingleObject(queue->worker_threads[worker_index], INFINITE);
+        CloseHandle(queue->worker_threads[worker_index]);
+    }
+
+    CloseHandle(queue->wake_semaphore);
+    DeleteCriticalSection(&queue->lock);
+}
+
+#define WIN32_JOB_BENCHMARK_SPAWN_ROUNDS 1000
+#define WIN32_JOB_BENCHMARK_SPAWN_COUNT 1000
+#define WIN32_JOB_BENCHMARK_ELEMENT_COUNT (1 << 24)
+#define WIN32_JOB_BENCHMARK_BATCH_SIZE 4096
+
+internal void Win32EmptyJob(PlatformWorkQueue* queue, void* data) {
+}
+
+struct Win32JobBenchmarkRange {
+    float32* elements;
+    int32_t first_index;
+    int32_t one_past_last_index;
+};
+
+internal void Win32JobBenchmarkKernel(void* data, int32_t first_index, int32_t one_past_last_index) {
+    float32* elements = static_cast<float32*>(data);
+
+    for(int32_t index = first_index; index < one_past_last_index; ++index) {
+        float32 value = elements[index];
+
+        for(int iteration = 0; iteration < 16; ++iteration) {
+            value = value * 0.999f + 0.5f;
+        }
+
+        elements[index] = value;
+    }
+}
+
+internal void Win32JobBenchmarkRangeJob(PlatformWorkQueue* queue, void* data) {
+    Win32JobBenchmarkRange* range = static_cast<Win32JobBenchmarkRange*>(data);
+    Win32JobBenchmarkKernel(range->elements, range->first_index, range->one_past_last_index);
+}
+
+// Note: Compares the work-stealing queue against a locked queue, for the per-task cost of spawning
+// trivial jobs and for how a parallel-for over a large array scales with worker count
+internal int Win32RunJobBenchmark() {
+    int max_worker_count = Win32GetDefaultWorkerCount();
+
+    Win32MutexWorkQueue* mutex_queue = static_cast<Win32MutexWorkQueue*>(VirtualAlloc(
+        0, sizeof(Win32MutexWorkQueue), MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE));
+    float32* elements = static_cast<float32*>(VirtualAlloc(
+        0, WIN32_JOB_BENCHMARK_ELEMENT_COUNT * sizeof(float32), MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE));
+
+    int range_count = WIN32_JOB_BENCHMARK_ELEMENT_COUNT / WIN32_JOB_BENCHMARK_BATCH_SIZE;
+    Win32JobBenchmarkRange* ranges = static_cast<Win32JobBenchmarkRange*>(VirtualAlloc(
+        0, range_count * sizeof(Win32JobBenchmarkRange), MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE));
+
+    for(int range_index = 0; range_index < range_count; ++range_index) {
+        ranges[range_index].elements = elements;
+        ranges[range_index].first_index = range_index * WIN32_JOB_BENCHMARK_BATCH_SIZE;
+        ranges[range_index].one_past_last_index = (range_index + 1) * WIN32_JOB_BENCHMARK_BATCH_SIZE;
+    }
+
+    PlatformWorkQueue queue;
+    float32 task_count = static_cast<float32>(WIN32_JOB_BENCHMARK_SPAWN_ROUNDS * WIN32_JOB_BENCHMARK_SPAWN_COUNT);
+
+    Win32Log("-- Spawn overhead, %d workers --\n", max_worker_count);
+
+    Win32BeginWorkQueue(&queue, max_worker_count);
+    LARGE_INTEGER spawn_start = Win32GetWallClock();
+
+    for(int round = 0; round < WIN32_JOB_BENCHMARK_SPAWN_ROUNDS; ++round) {
+        for(int job_index = 0; job_index < WIN32_JOB_BENCHMARK_SPAWN_COUNT; ++job_index) {
+            Win32AddWork(&queue, Win32EmptyJob, 0);
+        }
+
+        Win32CompleteAllWork(&queue);
+    }
+
+    float32 stealing_seconds = Win32GetSecondsElapsed(spawn_start, Win32GetWallClock());
+    Win32EndWorkQueue(&queue);
+
+    Win32BeginMutexWorkQueue(mutex_queue, max_worker_count);
+    spawn_start = Win32GetWallClock();
+
+    for(int round = 0; round < WIN32_JOB_BENCHMARK_SPAWN_ROUNDS; ++round) {
+        for(int job_index = 0; job_index < WIN32_JOB_BENCHMARK_SPAWN_COUNT; ++job_index) {
+            Win32AddMutexWork(mutex_queue, Win32EmptyJob, 0);
+        }
+
+        Win32CompleteAllMutexWork(mutex_queue);
+    }
+
+    float32 mutex_seconds = Win32GetSecondsElapsed(spawn_start, Win32GetWallClock());
+    Win32EndMutexWorkQueue(mutex_queue);
+
+    Win32Log(
+        "Work stealing: %.1fns/task, mutex queue: %.1fns/task\n",
+        1.0e9 * stealing_seconds / task_count, 1.0e9 * mutex_seconds / task_count);
+
+    Win32Log(
+        "-- Parallel-for over %d elements in batches of %d --\n",
+        WIN32_JOB_BENCHMARK_ELEMENT_COUNT, WIN32_JOB_BENCHMARK_BATCH_SIZE);
+
+    float32 serial_seconds = 0.0f;
+    int worker_count = 0;
+
+    for(;;) {
+        Win32BeginWorkQueue(&queue, worker_count);
+        LARGE_INTEGER parallel_for_start = Win32GetWallClock();
+        Win32ParallelFor(
+            &queue, WIN32_JOB_BENCHMARK_ELEMENT_COUNT, WIN32_JOB_BENCHMARK_BATCH_SIZE, Win32JobBenchmarkKernel,
+            elements);
+        stealing_seconds = Win32GetSecondsElapsed(parallel_for_start, Win32GetWallClock());
+        Win32EndWorkQueue(&queue);
+
+        Win32BeginMutexWorkQueue(mutex_queue, worker_count);
+        parallel_for_start = Win32GetWallClock();
+
+        for(int range_index = 0; range_index < range_count; ++range_index) {
+            Win32AddMutexWork(mutex_queue, Win32JobBenchmarkRangeJob, &ranges[range_index]);
+        }
+
+        Win32CompleteAllMutexWork(mutex_queue);
+        mutex_seconds = Win32GetSecondsElapsed(parallel_for_start, Win32GetWallClock());
+        Win32EndMutexWorkQueue(mutex_queue);
+
+        if(worker_count == 0) {
+            serial_seconds = stealing_seconds;
+        }
+
+        Win32Log(
+            "%2d workers: work stealing %.2fms (%.2fx), mutex queue %.2fms (%.2fx)\n",
+            worker_count, 1000.0 * stealing_seconds, serial_seconds / stealing_seconds,
+            1000.0 * mutex_seconds, serial_seconds / mutex_seconds);
+
+        if(worker_count == max_worker_count) {
+            break;
+        }
+
+        worker_count = worker_count ? worker_count * 2 : 1;
+
+        if(worker_count > max_worker_count) {
+            worker_count = max_worker_count;
+        }
+    }
+
+    VirtualFree(ranges, 0, MEM_RELEASE);
+    VirtualFree(elements, 0, MEM_RELEASE);
+    VirtualFree(mutex_queue, 0, MEM_RELEASE);
+
+    return 0;
+}
+
+#define WIN32_OVERLAY_BENCHMARK_WIDTH 1920
+#define WIN32_OVERLAY_BENCHMARK_HEIGHT 1080
+#define WIN32_OVERLAY_BENCHMARK_WARMUP_FRAMES 120
+#define WIN32_OVERLAY_BENCHMARK_FRAMES 6000
+
+#define WIN32_OVERLAY_BUDGET_SECONDS 0.0001f
+
+internal int Win32CompareFloat32(const void* a, const void* b) {
+    float32 value_a = *static_cast<const float32*>(a);
+    float32 value_b = *static_cast<const float32*>(b);
+
+    int result = (value_a > value_b) - (value_a < value_b);
+
+    return result;
+}
+
+// Note: Uniform in [0, 1)
+inline float32 Win32GetBenchmarkRandom(uint32_t* random_state) {
+    *random_state = *random_state * 1664525 + 1013904223;
+
+    float32 result = static_cast<float32>(*random_state >> 8) / 16777216.0f;
+
+    return result;
+}
+
+// Note: Draws through the game DLL's export, so it times the overlay code the game actually runs,
+// optimized as build.bat builds it. Fails unless the 99th percentile frame fits in the budget.
+internal int Win32RunOverlayBenchmark(Win32GameCode* game_code) {
+    if(!game_code->draw_performance_overlay) {
+        Win32Log("Couldn't load the overlay from the game code\n");
+        return -1;
+    }
+
+    GameOffscreenBuffer buffer = {};
+    buffer.width = WIN32_OVERLAY_BENCHMARK_WIDTH;
+    buffer.height = WIN32_OVERLAY_BENCHMARK_HEIGHT;
+    buffer.bytes_per_pixel = 4;
+    buffer.pitch = buffer.width * buffer.bytes_per_pixel;
+    buffer.memory = VirtualAlloc(
+        0, static_cast<SIZE_T>(buffer.pitch) * buffer.height, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+
+    OverlayState* overlay = static_cast<OverlayState*>(
+        VirtualAlloc(0, sizeof(OverlayState), MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE));
+    float32* draw_seconds = static_cast<float32*>(VirtualAlloc(
+        0, WIN32_OVERLAY_BENCHMARK_FRAMES * sizeof(float32), MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE));
+
+    if(!buffer.memory || !overlay || !draw_seconds) {
+        Win32Log("Couldn't allocate overlay benchmark memory\n");
+        return -1;
+    }
+
+    PlatformFrameStats stats = {};
+    stats.thread_count = PLATFORM_MAX_REPORTED_THREADS;
+
+    PlatformMemoryStats memory_stats = {};
+
+    uint32_t random_state = 1;
+    int total_frame_count = WIN32_OVERLAY_BENCHMARK_WARMUP_FRAMES + WIN32_OVERLAY_BENCHMARK_FRAMES;
+
+    for(int frame_index = 0; frame_index < total_frame_count; ++frame_index) {
+        // Note: Made-up stats that wander like a real game's, so the text changes as often as it would
+        stats.frame_seconds[stats.frame_count++ % PLATFORM_FRAME_HISTORY_COUNT] =
+            0.014f + 0.006f * Win32GetBenchmarkRandom(&random_state);
+
+        for(int32_t thread_index = 0; thread_index < stats.thread_count; ++thread_index) {
+            stats.thread_utilization[thread_index] = Win32GetBenchmarkRandom(&random_state);
+        }
+
+        memory_stats.resident_bytes = Megabytes(40) + static_cast<uint64_t>(
+            static_cast<float32>(Megabytes(8)) * Win32GetBenchmarkRandom(&random_state));
+        memory_stats.frame_page_fault_count = static_cast<uint32_t>(50.0f * Win32GetBenchmarkRandom(&random_state));
+
+        if(frame_index % 500 == 0) {
+            ++stats.code_reload_count;
+        }
+
+        // Note: The game redraws what's under the overlay every frame, so do that too (untimed)
+        for(int y = 0; y < OVERLAY_Y + OVERLAY_HEIGHT; ++y) {
+            uint32_t* pixel = reinterpret_cast<uint32_t*>(static_cast<uint8_t*>(buffer.memory) + y * buffer.pitch);
+
+            for(int x = 0; x < OVERLAY_X + OVERLAY_WIDTH; ++x) {
+                *pixel++ = ((x + frame_index) << 8) | y;
+            }
+        }
+
+        LARGE_INTEGER draw_start = Win32GetWallClock();
+        game_code->draw_performance_overlay(overlay, &stats, &memory_stats, &buffer);
+        float32 seconds = Win32GetSecondsElapsed(draw_start, Win32GetWallClock());
+
+        if(frame_index >= WIN32_OVERLAY_BENCHMARK_WARMUP_FRAMES) {
+            draw_seconds[frame_index - WIN32_OVERLAY_BENCHMARK_WARMUP_FRAMES] = seconds;
+        }
+    }
+
+    double total_seconds = 0.0;
+    for(int frame_index = 0; frame_index < WIN32_OVERLAY_BENCHMARK_FRAMES; ++frame_index) {
+        total_seconds += draw_seconds[frame_index];
+    }
+
+    qsort(draw_seconds, WIN32_OVERLAY_BENCHMARK_FRAMES, sizeof(float32), Win32CompareFloat32);
+
+    float32 percentile_seconds = draw_seconds[WIN32_OVERLAY_BENCHMARK_FRAMES * 99 / 100];
+    float32 worst_seconds = draw_seconds[WIN32_OVERLAY_BENCHMARK_FRAMES - 1];
+    bool32 is_within_budget = percentile_seconds <= WIN32_OVERLAY_BUDGET_SECONDS;
+
+    Win32Log(
+        "Overlay at %dx%d over %d frames: %.4fms mean, %.4fms 99th percentile, %.4fms worst\n",
+        buffer.width, buffer.height, WIN32_OVERLAY_BENCHMARK_FRAMES,
+        1000.0 * total_seconds / WIN32_OVERLAY_BENCHMARK_FRAMES, 1000.0 * percentile_seconds,
+        1000.0 * worst_seconds);
+    Win32Log(
+        "Layout cache: %llu hits, %llu misses\n", overlay->layouts.hit_count, overlay->layouts.miss_count);
+
+    Win32Log(
+        "%s: the budget is %.4fms\n", is_within_budget ? "Passed" : "FAILED", 1000.0 * WIN32_OVERLAY_BUDGET_SECONDS);
+    int result = is_within_budget ? 0 : 1;
+
+    VirtualFree(draw_seconds, 0, MEM_RELEASE);
+    VirtualFree(overlay, 0, MEM_RELEASE);
+    VirtualFree(buffer.memory, 0, MEM_RELEASE);
+
+    return result;
+}
+
+internal LRESULT CALLBACK Win32MainWindowCallback(HWND window, UINT message, WPARAM w_param, LPARAM l_param) {
+    LRESULT result = 0;
+
+    switch(message) {
+        case WM_CLOSE: {
+            Win32PostInputCommand(Win32InputCommand_Quit);
+            break;
+        }
+
+        case WM_SETCURSOR: {
+            SetCursor(0);
+            break;
+        }
+
+        case WM_ACTIVATEAPP: {
+            break;
+        }
+
+        case WM_DESTROY: {
+            Win32PostInputCommand(Win32InputCommand_Quit);
+            PostQuitMessage(0);
+            break;
+        }
+
+        case WM_SYSKEYDOWN:
+        case WM_SYSKEYUP:
+        case WM_KEYDOWN:
+        case WM_KEYUP: {
+            Assert(!"Keyboard input came in through a non-dispatch message!");
+            break;
+        }
+
+        case WM_PAINT: {
+            // Note: The back buffer belongs to the simulation thread, which presents a fresh frame
+            // every frame anyway, so just validate the window here
+            PAINTSTRUCT paint;
+            BeginPaint(window, &paint);
+            EndPaint(window, &paint);
+            break;
+        }
+
+        default: {
+            result = DefWindowProc(window, message, w_param, l_param);
+            break;
+        }
+    }
+
+    return result;
+}
+
+int CALLBACK WinMain(HINSTANCE instance, HINSTANCE _unused, LPSTR command_line, int show_code) {
+    Win32State win32_state = {};
+
+    Win32GetExecutableFileName(&win32_state);
+
+    char source_game_code_dll_full_path[WIN32_STATE_FILE_NAME_COUNT];
+    Win32BuildExecutablePathFileName(
+        &win32_state, "watcher.dll", sizeof(source_game_code_dll_full_path), source_game_code_dll_full_path);
+
+    char temp_game_code_dll_full_path[WIN32_STATE_FILE_NAME_COUNT];
+    Win32BuildExecutablePathFileName(
+        &win32_state, "watcher_temp.dll", sizeof(temp_game_code_dll_full_path), temp_game_code_dll_full_path);
+
+    char game_code_lock_full_path[WIN32_STATE_FILE_NAME_COUNT];
+    Win32BuildExecutablePathFileName(
+        &win32_state, "lock.tmp", sizeof(game_code_lock_full_path), game_code_lock_full_path);
+
+    Win32BuildExecutablePathFileName(
+        &win32_state, "watcher_input.nwt",
+        sizeof(win32_state.input_trace_filename), win32_state.input_trace_filename);
+
+    Win32BuildExecutablePathFileName(
+        &win32_state, "watcher_checkpoints.nwc",
+        sizeof(win32_state.checkpoint_filename), win32_state.checkpoint_filename);
+
+    Win32BuildExecutablePathFileName(
+        &win32_state, "watcher_resolution.csv",
+        sizeof(win32_state.resolution_trace_filename), win32_state.resolution_trace_filename);
+
+    Win32BuildExecutablePathFileName(
+        &win32_state, "watcher_memory.txt",
+        sizeof(win32_state.memory_report_filename), win32_state.memory_report_filename);
+
+    Win32BuildExecutablePathFileName(
+        &win32_state, "watcher_memory_pages.csv",
+        sizeof(win32_state.memory_pages_filename), win32_state.memory_pages_filename);
+
+    win32_state.input_trace_block_memory = VirtualAlloc(
+        0, INPUT_TRACE_MAX_BLOCK_PAYLOAD_SIZE, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+
+    LARGE_INTEGER perf_count_frequency_result;
+    QueryPerformanceFrequency(&perf_count_frequency_result);
+    g_perf_count_frequency = perf_count_frequency_result.QuadPart;
+
+    Win32LoadXInput();
+
+    WNDCLASS window_class = {};
+
+    Win32ResizeDibSection(&g_back_buffer, 960, 540);
+
+    char* command_line_arguments;
+
+    if(Win32MatchCommandLineSwitch(command_line, "-checkpoint-bench", &command_line_arguments)) {
+        Win32AttachParentConsole();
+
+        return Win32RunCheckpointBenchmark(win32_state.checkpoint_filename);
+    }
+
+    if(Win32MatchCommandLineSwitch(command_line, "-jobs-bench", &command_line_arguments)) {
+        Win32AttachParentConsole();
+
+        return Win32RunJobBenchmark();
+    }
+
+    if(Win32MatchCommandLineSwitch(command_line, "-overlay-bench", &command_line_arguments)) {
+        Win32AttachParentConsole();
+
+        Win32GameCode benchmark_game = Win32LoadGameCode(
+            source_game_code_dll_full_path, temp_game_code_dll_full_path, game_code_lock_full_path);
+
+        int result = Win32RunOverlayBenchmark(&benchmark_game);
+        Win32UnloadGameCode(&benchmark_game);
+
+        return result;
+    }
+
+    Win32BeginWorkQueue(&win32_state.work_queue, Win32GetDefaultWorkerCount());
+
+    GameMemory game_memory = {};
+    game_memory.platform.work_queue = &win32_state.work_queue;
+    game_memory.platform.add_work = Win32AddWork;
+    game_memory.platform.complete_all_work = Win32CompleteAllWork;
+    game_memory.platform.parallel_for = Win32ParallelFor;
+    game_memory.permanent_storage_size = Megabytes(256);
+    game_memory.transient_storage_size = Megabytes(64);
+
+    // Note: Write-watched, so checkpoints only have to copy the pages the game actually touched
+    win32_state.total_size = game_memory.permanent_storage_size;
+    win32_state.game_memory_block = VirtualAlloc(
+        0, win32_state.total_size, MEM_RESERVE | MEM_COMMIT | MEM_WRITE_WATCH, PAGE_READWRITE);
+    game_memory.permanent_storage = win32_state.game_memory_block;
+
+    // Note: Kept out of the write-watched block, since checkpoints never need it
+    game_memory.transient_storage = VirtualAlloc(
+        0, game_memory.transient_storage_size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+
+    if(!game_memory.permanent_storage || !game_memory.transient_storage) {
+        Win32Log(
+            "Couldn't allocate game memory, %llu MB permanent and %llu MB transient\n",
+            game_memory.permanent_storage_size / Megabytes(1), game_memory.transient_storage_size / Megabytes(1));
+        return -1;
+    }
+
+    char replay_trace_filename[WIN32_STATE_FILE_NAME_COUNT];
+    uint32_t replay_first_frame_index;
+
+    if(Win32ParseReplayCommandLine(
+            command_line, sizeof(replay_trace_filename), replay_trace_filename, &replay_first_frame_index)) {
+        Win32AttachParentConsole();
+
+        Win32GameCode replay_game = Win32LoadGameCode(
+            source_game_code_dll_full_path, temp_game_code_dll_full_path, game_code_lock_full_path);
+
+        return Win32ReplayInputTraceHeadless(
+            &replay_game, &game_memory, replay_trace_filename, replay_first_frame_index);
+    }
+
+    Win32BeginMemoryTelemetry(
+        &win32_state.memory_telemetry, &game_memory.memory_stats,
+        win32_state.game_memory_block, win32_state.total_size);
+
+    // Note: Picks up where the last session's checkpoints left off, instead of from zeroed memory
+    bool32 is_resuming = Win32MatchCommandLineSwitch(command_line, "-resume", &command_line_arguments);
+
+    if(Win32BeginCheckpointer(
+            &win32_state.checkpointer, win32_state.checkpoint_filename,
+            win32_state.game_memory_block, win32_state.total_size, &game_memory.memory_stats, is_resuming) &&
+            is_resuming) {
+        Win32RestoreCheckpoint(&win32_state.checkpointer);
+    }
+
+    Win32BeginResolutionScaler(
+        &win32_state.resolution_scaler, &g_back_buffer, win32_state.resolution_trace_filename);
+
+    window_class.style = CS_HREDRAW | CS_VREDRAW;
+    window_class.lpfnWndProc = Win32MainWindowCallback;
+    window_class.hInstance = instance;
+    window_class.hCursor = LoadCursor(0, IDC_ARROW);
+    // window_class.hIcon = ;
+    window_class.lpszClassName = "NamelessWatcherWindowClass";
+
+    if(!RegisterClass(&window_class)) {
+        // TODO: Log
+        return -1;
+    }
+
+    g_is_running = true;
+
+    Win32MessageThreadStartup message_thread_startup = {};
+    message_thread_startup.instance = instance;
+    message_thread_startup.window_class_name = window_class.lpszClassName;
+    message_thread_startup.window_created_event = CreateEventA(0, FALSE, FALSE, 0);
+
+    DWORD message_thread_id;
+    HANDLE message_thread = CreateThread(
+        0, 0, Win32MessageThreadProc, &message_thread_startup, 0, &message_thread_id);
+
+    if(!message_thread) {
+        Win32Log("Couldn't start the message thread\n");
+        return -1;
+    }
+
+    WaitForSingleObject(message_thread_startup.window_created_event, INFINITE);
+    CloseHandle(message_thread_startup.window_created_event);
+
+    HWND window = message_thread_startup.window;
+
+    if(!window) {
+        Win32Log("Couldn't create the window\n");
+        return -1;
+    }
+
+    GameInput input[2] = {};
+    GameInput* new_input = &input[0];
+    GameInput* old_input = &input[1];
+
+    Win32GameCode game = Win32LoadGameCode(
+        source_game_code_dll_full_path, temp_game_code_dll_full_path, game_code_lock_full_path);
+
+    uint32_t frames_since_checkpoint = 0;
+
+    while(g_is_running) {
+        LARGE_INTEGER frame_start = Win32GetWallClock();
+
+        FILETIME new_dll_write_time = Win32GetLastWriteTime(source_game_code_dll_full_path);
+
+        if(CompareFileTime(&new_dll_write_time, &game.dll_last_write_time) != 0) {
+            // Note: Queued callbacks point into the old DLL
+            Win32CompleteAllWork(&win32_state.work_queue);
+            Win32UnloadGameCode(&game);
+            game = Win32LoadGameCode(
+                source_game_code_dll_full_path, temp_game_code_dll_full_path, game_code_lock_full_path);
+            ++game_memory.frame_stats.code_reload_count;
+        }
+
+        GameControllerInput* old_keyboard_controller = GetController(old_input, 0);
+        GameControllerInput* new_keyboard_controller = GetController(new_input, 0);
+        *new_keyboard_controller = {};
+        new_keyboard_controller->is_connected = true;
+
+        for(int button_index = 0; button_index < NUM_SUPPORTED_CONTROLLER_BUTTONS; ++button_index) {
+            new_keyboard_controller->buttons[button_index].ended_down =
+                old_keyboard_controller->buttons[button_index].ended_down;
+        }
+
+        for(int button_index = 0; button_index < NUM_SUPPORTED_MOUSE_BUTTONS; ++button_index) {
+            new_input->mouse_buttons[button_index] = {};
+            new_input->mouse_buttons[button_index].ended_down = old_input->mouse_buttons[button_index].ended_down;
+        }
+
+        InputEvent commands[WIN32_MAX_INPUT_COMMANDS_PER_FRAME];
+        uint32_t command_count = DrainInputEvents(
+            &g_input_events, new_keyboard_controller, new_input->mouse_buttons,
+            commands, WIN32_MAX_INPUT_COMMANDS_PER_FRAME);
+
+        for(uint32_t command_index = 0; command_index < command_count; ++command_index) {
+            Win32ProcessInputCommand(&win32_state, commands[command_index].index);
+        }
+
+        POINT mouse_pos;
+        GetCursorPos(&mouse_pos);
+        ScreenToClient(window, &mouse_pos);
+
+        new_input->mouse_x = mouse_pos.x;
+        new_input->mouse_y = mouse_pos.y;
+        new_input->mouse_z = 0;
+
+        DWORD MaxControllerCount = XUSER_MAX_COUNT;
+
+        for (DWORD controller_index = 0; controller_index < MaxControllerCount; ++controller_index) {
+            DWORD our_controller_index = controller_index + 1;
+            GameControllerInput* old_controller = GetController(old_input, our_controller_index);
+            GameControllerInput* new_controller = GetController(new_input, our_controller_index);
+
+            XINPUT_STATE controller_state;
+
+            if(XInputGetState(controller_index, &controller_state) == ERROR_SUCCESS) {
+                new_controller->is_connected = true;
+                new_controller->is_analog = old_controller->is_analog;
+
+                XINPUT_GAMEPAD* pad = &controller_state.Gamepad;
+
+                new_controller->stick_average_x = Win32ProcessXInputStickValue(
+                    pad->sThumbLX, XINPUT_GAMEPAD_LEFT_THUMB_DEADZONE);
+                new_controller->stick_average_y = Win32ProcessXInputStickValue(
+                    pad->sThumbLY, XINPUT_GAMEPAD_LEFT_THUMB_DEADZONE);
+
+                if(new_controller->stick_average_x != 0.0f || new_controller->stick_average_y != 0.0f) {
+                    new_controller->is_analog = true;
+                }
+
+                if(pad->wButtons & XINPUT_GAMEPAD_DPAD_UP) {
+                    new_controller->stick_average_y = 1.0f;
+                    new_controller->is_analog = false;
+                }
+
+                if(pad->wButtons & XINPUT_GAMEPAD_DPAD_DOWN) {
                     new_controller->stick_average_y = -1.0f;
                     new_controller->is_analog = false;
                 }
@@ -642,8 +3447,25 @@ int CALLBACK WinMain(HINSTANCE instance, HINSTANCE _unused, LPSTR command_line,
         offscreen_buffer.pitch = g_back_buffer.pitch;
         offscreen_buffer.bytes_per_pixel = g_back_buffer.bytes_per_pixel;
 
+        if(win32_state.recording_handle) {
+            Win32RecordInput(&win32_state, new_input);
+        }
+
+        if(win32_state.playback_handle) {
+            Win32PlayBackInput(&win32_state, new_input);
+        }
+
+        LARGE_INTEGER render_start = Win32GetWallClock();
+
         if(game.update_and_render) {
-            game.update_and_render(new_input, &offscreen_buffer);
+            game.update_and_render(&game_memory, new_input, &offscreen_buffer);
+        }
+
+        float32 render_seconds = Win32GetSecondsElapsed(render_start, Win32GetWallClock());
+
+        if(++frames_since_checkpoint >= WIN32_CHECKPOINT_INTERVAL_FRAMES &&
+                Win32BeginCheckpoint(&win32_state.checkpointer)) {
+            frames_since_checkpoint = 0;
         }
 
         HDC device_context = GetDC(window);
@@ -651,10 +3473,32 @@ int CALLBACK WinMain(HINSTANCE instance, HINSTANCE _unused, LPSTR command_line,
         Win32DisplayBufferInWindow(&g_back_buffer, device_context, dimension.width, dimension.height);
         ReleaseDC(window, device_context);
 
+        Win32UpdateResolutionScaler(&win32_state.resolution_scaler, &g_back_buffer, render_seconds);
+
+        Win32UpdateFrameStats(
+            &game_memory.frame_stats, &win32_state.work_queue, frame_start, Win32GetWallClock(), render_seconds);
+        Win32SampleMemoryStats(&win32_state.memory_telemetry, &game_memory.memory_stats);
+
 		GameInput* temp_input = new_input;
 		new_input = old_input;
 		old_input = temp_input;
     }
 
+    if(win32_state.recording_handle) {
+        Win32EndInputRecording(&win32_state);
+    }
+
+    Win32EndResolutionScaler(&win32_state.resolution_scaler);
+    Win32EndCheckpointer(&win32_state.checkpointer);
+    Win32EndMemoryTelemetry(
+        &win32_state.memory_telemetry, &game_memory.memory_stats,
+        win32_state.memory_report_filename, win32_state.memory_pages_filename);
+    Win32EndWorkQueue(&win32_state.work_queue);
+
+    // Note: The window goes away with the thread that owns it
+    PostThreadMessageA(message_thread_id, WM_QUIT, 0, 0);
+    WaitForSingleObject(message_thread, INFINITE);
+    CloseHandle(message_thread);
+
     return 0;
 }